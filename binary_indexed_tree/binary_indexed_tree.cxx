@@ -1,15 +1,36 @@
 #include <vector>
+#include <array>
+#include <new>
 
 #define LB(x) ((x) & (-(x)))
 
 using namespace std;
 
+// a group is a monoid whose elements all have an inverse, and whose combine is commutative
+// the tree only needs the inverse for range queries, prefix queries and updates work with any commutative monoid
+template <typename T>
+struct SumGroup
+{
+    static T identity() { return T(0); }
+    static T combine(const T &a, const T &b) { return a + b; }
+    static T inverse(const T &a) { return -a; }
+};
+
+template <typename T>
+struct XorGroup
+{
+    static T identity() { return T(0); }
+    static T combine(const T &a, const T &b) { return a ^ b; }
+    static T inverse(const T &a) { return a; }
+};
+
+template <typename T = int, typename Group = SumGroup<T>>
 struct BinaryIndexedTree {
-    vector<int> val;
+    vector<T> val;
     int n;
-    BinaryIndexedTree(const vector<int>& raw) {
+    BinaryIndexedTree(const vector<T>& raw) {
         n = raw.size();
-        val = vector<int>(n + 1);
+        val = vector<T>(n + 1, Group::identity());
 
         // first, copy the raw array to the val array
         for (int i = 0; i < n; ++i) val[i + 1] = raw[i];
@@ -25,34 +46,320 @@ struct BinaryIndexedTree {
             // since the parent of i should adds val[i] only once,
             // so the grand parent of i adds val[i] only once, and so on
             int j = i + LB(i);
-            if (j <= n) val[j] += val[i];
+            if (j <= n) val[j] = Group::combine(val[j], val[i]);
         }
     }
 
     // query the sum from 1..=i, starts from 1
-    int query(int i)
+    T query(int i) const
     {
-        int ret = 0;
-        while (i > 0)
+        T ret = Group::identity();
+        // add val[i] to the result, because val[i] is the sum of raw whose index in binary is the prefix of i
+        // it is within the range of 1..=i
+        // i -= LB(i) is the parent of i
+        // the body has no branch, so the only one left is the loop condition
+        for (; i > 0; i -= LB(i)) ret = Group::combine(ret, val[i]);
+        return ret;
+    }
+
+    // query the sum from l..=r, starts from 1
+    T query(int l, int r) const
+    {
+        return Group::combine(query(r), Group::inverse(query(l - 1)));
+    }
+
+    // update the value of raw[i]
+    void update(int i, T diff)
+    {
+        for (; i <= n; i += LB(i)) val[i] = Group::combine(val[i], diff);
+    }
+
+    // the smallest i such that query(i) >= prefix, or n + 1 if there is none
+    // only makes sense for sums of non-negative values, where query(i) never decreases
+    // instead of a binary search over query, which is O(log^2 n), walk down the implicit tree
+    // pos + step covers raw[pos + 1..=pos + step], so it either jumps over it or looks inside it
+    int lower_bound(T prefix) const
+    {
+        int step = 1;
+        while (step * 2 <= n) step *= 2;
+        int pos = 0;
+        T acc = Group::identity();
+        for (; step > 0; step /= 2)
         {
-            // add val[i] to the result, because val[i] is the sum of raw whose index in binary is the prefix of i
-            // it is within the range of 1..=i
-            ret += val[i];
+            if (pos + step <= n && Group::combine(acc, val[pos + step]) < prefix)
+            {
+                pos += step;
+                acc = Group::combine(acc, val[pos]);
+            }
+        }
+        return pos + 1;
+    }
+};
 
-            // i -= LB(i) is the parent of i
-            i -= LB(i);
+// the old name of the tree, tree_array/tree_array.cxx was a copy of it
+using TreeArray = BinaryIndexedTree<int>;
+
+// range add and range sum with two trees, also known as the dual BIT
+// let d be the difference array of raw, d[i] = raw[i] - raw[i - 1]
+// then the prefix sum of raw up to i is (i + 1) * sum(d[1..=i]) - sum(j * d[j] for j in 1..=i)
+// so one tree keeps d, the other keeps j * d[j], and a range add only changes d at two points
+template <typename T = int>
+struct RangeBinaryIndexedTree {
+    BinaryIndexedTree<T> d;
+    BinaryIndexedTree<T> jd;
+    int n;
+    RangeBinaryIndexedTree(const vector<T>& raw) : d(diff(raw)), jd(weighted(diff(raw))), n(raw.size()) {}
+
+    // add delta to raw[l..=r], starts from 1
+    void range_add(int l, int r, T delta)
+    {
+        d.update(l, delta);
+        d.update(r + 1, -delta);
+        jd.update(l, delta * T(l));
+        jd.update(r + 1, -delta * T(r + 1));
+    }
+
+    // query the sum from 1..=i, starts from 1
+    T query(int i) const
+    {
+        return d.query(i) * T(i + 1) - jd.query(i);
+    }
+
+    // query the sum from l..=r, starts from 1
+    T query(int l, int r) const
+    {
+        return query(r) - query(l - 1);
+    }
+
+private:
+    static vector<T> diff(const vector<T>& raw)
+    {
+        vector<T> ret(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) ret[i] = raw[i] - (i > 0 ? raw[i - 1] : T(0));
+        return ret;
+    }
+
+    static vector<T> weighted(vector<T> d)
+    {
+        for (size_t i = 0; i < d.size(); ++i) d[i] *= T(i + 1);
+        return d;
+    }
+};
+
+// allocates on a page boundary, so that every block of BlockedBinaryIndexedTree is exactly one page
+template <typename T>
+struct PageAlignedAllocator
+{
+    using value_type = T;
+    static constexpr size_t ALIGNMENT = 4096;
+    PageAlignedAllocator() = default;
+    template <typename U>
+    PageAlignedAllocator(const PageAlignedAllocator<U> &) {}
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(ALIGNMENT))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(ALIGNMENT)); }
+    template <typename U>
+    bool operator==(const PageAlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const PageAlignedAllocator<U> &) const { return false; }
+};
+
+// the same query and update as BinaryIndexedTree, laid out for arrays far bigger than the cache
+// in the plain tree, the steps of one query land all over val, each one a cache and TLB miss
+// here raw is cut into blocks of B elements, and every block is a small binary indexed tree of its own
+// so the steps inside a block stay within B * sizeof(T) bytes, 4KB by default
+// the blocks are allocated on a page boundary, so with the default B every block is exactly one page
+// the totals of the blocks form another binary indexed tree, which is B times smaller and stays in cache
+template <typename T = int, int B = 4096 / sizeof(T)>
+struct BlockedBinaryIndexedTree {
+    // block k holds raw[k * B + 1..=(k + 1) * B] at local[k * B..(k + 1) * B], so node j of the block is block[j - 1]
+    vector<T, PageAlignedAllocator<T>> local;
+    BinaryIndexedTree<T> summary;
+    int n;
+
+    BlockedBinaryIndexedTree(const vector<T>& raw) : summary(block_totals(raw)), n(raw.size()) {
+        int blocks = (n + B - 1) / B;
+        local = vector<T, PageAlignedAllocator<T>>((size_t)blocks * B, T(0));
+        for (int i = 0; i < n; ++i) local[i] = raw[i];
+        // the linear build of the 1D constructor, once per block
+        for (int k = 0; k < blocks; ++k)
+        {
+            T *block = local.data() + (size_t)k * B;
+            for (int j = 1; j < B; ++j)
+            {
+                int p = j + LB(j);
+                if (p <= B) block[p - 1] += block[j - 1];
+            }
         }
+    }
+
+    // query the sum from 1..=i, starts from 1
+    T query(int i) const
+    {
+        if (i <= 0) return T(0);
+        int k = (i - 1) / B;
+        // the whole blocks before k come from the summary, the rest from block k itself
+        T ret = summary.query(k);
+        const T *block = local.data() + (size_t)k * B;
+        for (int j = (i - 1) % B + 1; j > 0; j -= LB(j)) ret += block[j - 1];
         return ret;
     }
 
+    // query the sum from l..=r, starts from 1
+    T query(int l, int r) const
+    {
+        return query(r) - query(l - 1);
+    }
+
     // update the value of raw[i]
-    void update(int i, int diff)
+    void update(int i, T diff)
     {
-        while (i <= n)
+        int k = (i - 1) / B;
+        T *block = local.data() + (size_t)k * B;
+        for (int j = (i - 1) % B + 1; j <= B; j += LB(j)) block[j - 1] += diff;
+        summary.update(k + 1, diff);
+    }
+
+private:
+    static vector<T> block_totals(const vector<T>& raw)
+    {
+        vector<T> ret((raw.size() + B - 1) / B, T(0));
+        for (size_t i = 0; i < raw.size(); ++i) ret[i / B] += raw[i];
+        return ret;
+    }
+};
+
+// a binary indexed tree over a D dimensional grid, D is fixed at compile time
+// every dimension is an independent binary indexed tree, so update and prefix query walk
+// the LB chain of every coordinate, that is, O(log n_1 * log n_2 * ... * log n_D)
+// the nodes are stored in one row-major vector, the last dimension being contiguous
+template <typename T, int D>
+struct NdBinaryIndexedTree {
+    // dims[d] is the size of dimension d, coordinates start from 1 like the 1D tree
+    array<int, D> dims;
+    // stride[d] is the distance in val between two neighbours along dimension d
+    array<size_t, D> stride;
+    vector<T> val;
+
+    // raw is the grid in row-major order, with dims[d] elements along dimension d
+    NdBinaryIndexedTree(const array<int, D>& dims, const vector<T>& raw) : dims(dims) {
+        size_t size = 1;
+        for (int d = D - 1; d >= 0; --d)
         {
-            val[i] += diff;
-            i += LB(i);
+            stride[d] = size;
+            size *= dims[d] + 1;
+        }
+        val = vector<T>(size, T(0));
+
+        // copy raw to val, the 0th slice of every dimension isn't used
+        // c counts through the coordinates of pos like an odometer, the last dimension turning fastest
+        array<int, D> c{};
+        for (size_t pos = 0, from = 0; pos < size; ++pos)
+        {
+            bool inside = true;
+            for (int d = 0; d < D; ++d) inside = inside && c[d] > 0;
+            if (inside) val[pos] = raw[from++];
+            for (int d = D - 1; d >= 0 && ++c[d] > dims[d]; --d) c[d] = 0;
+        }
+
+        // then build every dimension in turn, the same way as the 1D constructor
+        // after the pass over dimension d, val is a binary indexed tree along dimensions 0..=d
+        // so the whole build is O(D * size) instead of one update per element
+        // the innermost loop runs over the contiguous dimensions after d, so it has no branch
+        for (int d = 0; d < D; ++d)
+        {
+            size_t block = stride[d] * (dims[d] + 1);
+            for (size_t outer = 0; outer < size; outer += block)
+            {
+                for (int i = 1; i <= dims[d]; ++i)
+                {
+                    if (i + LB(i) > dims[d]) continue;
+                    T *from = val.data() + outer + i * stride[d];
+                    T *to = from + LB(i) * stride[d];
+                    for (size_t inner = 0; inner < stride[d]; ++inner) to[inner] += from[inner];
+                }
+            }
+        }
+    }
+
+    // add diff to the element at idx, starts from 1
+    void update(const array<int, D>& idx, T diff)
+    {
+        update<0>(0, idx, diff);
+    }
+
+    // query the sum of the box from (1, .., 1) to idx, both inclusive
+    T query(const array<int, D>& idx) const
+    {
+        return query<0>(0, idx);
+    }
+
+    // query the sum of the box from lo to hi, both inclusive, starts from 1
+    // by inclusion-exclusion over the 2 ** D corners of the box
+    T query(const array<int, D>& lo, const array<int, D>& hi) const
+    {
+        T ret = T(0);
+        for (int mask = 0; mask < (1 << D); ++mask)
+        {
+            array<int, D> corner;
+            int picked = 0;
+            for (int d = 0; d < D; ++d)
+            {
+                bool low = (mask >> d) % 2 == 1;
+                corner[d] = low ? lo[d] - 1 : hi[d];
+                picked += low;
+            }
+            if (picked % 2 == 0) ret += query(corner);
+            else ret -= query(corner);
+        }
+        return ret;
+    }
+
+private:
+    // one level of the nested loops per dimension, unrolled at compile time
+    template <int K>
+    void update(size_t base, const array<int, D>& idx, T diff)
+    {
+        for (int i = idx[K]; i <= dims[K]; i += LB(i))
+        {
+            if constexpr (K + 1 == D) val[base + i * stride[K]] += diff;
+            else update<K + 1>(base + i * stride[K], idx, diff);
+        }
+    }
+
+    template <int K>
+    T query(size_t base, const array<int, D>& idx) const
+    {
+        T ret = T(0);
+        for (int i = idx[K]; i > 0; i -= LB(i))
+        {
+            if constexpr (K + 1 == D) ret += val[base + i * stride[K]];
+            else ret += query<K + 1>(base + i * stride[K], idx);
         }
+        return ret;
+    }
+};
+
+// the 2D tree with plain (x, y) arguments, x is the row and y is the column
+template <typename T = int>
+struct BinaryIndexedTree2D : NdBinaryIndexedTree<T, 2> {
+    // raw is an n x m grid in row-major order
+    BinaryIndexedTree2D(int n, int m, const vector<T>& raw) : NdBinaryIndexedTree<T, 2>({n, m}, raw) {}
+
+    void update(int x, int y, T diff)
+    {
+        NdBinaryIndexedTree<T, 2>::update({x, y}, diff);
+    }
+
+    // query the sum of the rectangle from (1, 1) to (x, y)
+    T query(int x, int y) const
+    {
+        return NdBinaryIndexedTree<T, 2>::query({x, y});
+    }
+
+    // query the sum of the rectangle from (x1, y1) to (x2, y2), both inclusive
+    T query(int x1, int y1, int x2, int y2) const
+    {
+        return NdBinaryIndexedTree<T, 2>::query({x1, y1}, {x2, y2});
     }
 };
 
@@ -66,5 +373,226 @@ int main() {
     printf("%d\n", tree.query(5));
     tree.update(1, 1);
     printf("%d\n", tree.query(5));
+    printf("%d %d\n", tree.query(2, 4), tree.lower_bound(4));
+
+    vector<long long> counters = { 3000000000LL, 1, 2 };
+    BinaryIndexedTree<long long> big(counters);
+    printf("%lld\n", big.query(3));
+
+    RangeBinaryIndexedTree<long long> range(counters);
+    range.range_add(2, 3, 10);
+    printf("%lld %lld\n", range.query(2, 3), range.query(3));
+
+    // 1 2 3
+    // 4 5 6
+    BinaryIndexedTree2D<int> grid(2, 3, { 1, 2, 3, 4, 5, 6 });
+    printf("%d %d\n", grid.query(2, 3), grid.query(1, 2, 2, 3));
+    grid.update(2, 2, 10);
+    printf("%d\n", grid.query(2, 2, 2, 3));
 }
-#endif
\ No newline at end of file
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./binary_indexed_tree [n]
+// try n = 200000000 for the blocked tree, where the plain one misses the cache on every step
+// cache and TLB misses come from perf_event_open, they read n/a where it isn't permitted
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// counts the cache misses and the data TLB read misses of this thread between start and stop
+struct PerfCounters {
+    int cache_fd;
+    int tlb_fd;
+    long long cache_misses;
+    long long tlb_misses;
+
+    PerfCounters() : cache_fd(open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)),
+        tlb_fd(open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))),
+        cache_misses(-1), tlb_misses(-1) {}
+
+    ~PerfCounters() {
+        if (cache_fd >= 0) close(cache_fd);
+        if (tlb_fd >= 0) close(tlb_fd);
+    }
+
+    void start() {
+        for (int fd : {cache_fd, tlb_fd}) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void stop() {
+        cache_misses = read_counter(cache_fd);
+        tlb_misses = read_counter(tlb_fd);
+    }
+
+    // the misses per operation, or n/a if the counter couldn't be opened
+    static string per(long long misses, int rounds) {
+        return misses < 0 ? "n/a" : to_string((double)misses / rounds);
+    }
+
+private:
+    static int open(unsigned type, unsigned long long config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = type;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static long long read_counter(int fd) {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count;
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+};
+
+// the implementation before the tree was templated, kept to compare against
+struct LegacyBinaryIndexedTree {
+    vector<int> val;
+    int n;
+    LegacyBinaryIndexedTree(const vector<int>& raw) {
+        n = raw.size();
+        val = vector<int>(n + 1);
+        for (int i = 0; i < n; ++i) val[i + 1] = raw[i];
+        for (int i = 1; i <= n; ++i)
+        {
+            int j = i + LB(i);
+            if (j <= n) val[j] += val[i];
+        }
+    }
+    int query(int i)
+    {
+        int ret = 0;
+        while (i > 0)
+        {
+            ret += val[i];
+            i -= LB(i);
+        }
+        return ret;
+    }
+    void update(int i, int diff)
+    {
+        while (i <= n)
+        {
+            val[i] += diff;
+            i += LB(i);
+        }
+    }
+};
+
+template <typename Tree>
+void run(const string& name, const vector<int>& raw, const vector<int>& idx)
+{
+    int rounds = idx.size();
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    auto t0 = chrono::high_resolution_clock::now();
+    Tree tree(raw);
+    PerfCounters query_perf, update_perf;
+    auto t1 = chrono::high_resolution_clock::now();
+    long long sum = 0;
+    query_perf.start();
+    for (int i = 0; i < rounds; ++i) sum += tree.query(idx[i]);
+    query_perf.stop();
+    auto t2 = chrono::high_resolution_clock::now();
+    update_perf.start();
+    for (int i = 0; i < rounds; ++i) tree.update(idx[i], i % 100);
+    update_perf.stop();
+    auto t3 = chrono::high_resolution_clock::now();
+    cout << name << ": build " << ms(t0, t1) << "ms"
+         << ", query " << ms(t1, t2) * 1e6 / rounds << "ns"
+         << " (" << PerfCounters::per(query_perf.cache_misses, rounds) << " cache misses"
+         << ", " << PerfCounters::per(query_perf.tlb_misses, rounds) << " tlb misses)"
+         << ", update " << ms(t2, t3) * 1e6 / rounds << "ns"
+         << " (" << PerfCounters::per(update_perf.cache_misses, rounds) << " cache misses"
+         << ", " << PerfCounters::per(update_perf.tlb_misses, rounds) << " tlb misses)"
+         << " (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? stoi(argv[1]) : 10000000;
+    constexpr int ROUNDS = 10000000;
+    mt19937 rng(0);
+    vector<int> raw(n);
+    for (int &x : raw) x = rng() % 100;
+    vector<int> idx(ROUNDS);
+    for (int &i : idx) i = 1 + rng() % n;
+
+    run<LegacyBinaryIndexedTree>("legacy int", raw, idx);
+    run<BinaryIndexedTree<int>>("templated int", raw, idx);
+    run<BlockedBinaryIndexedTree<int>>("blocked int", raw, idx);
+
+    // a loop of point updates against one range add, for ranges of 1000 elements
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    constexpr int WIDTH = 1000, RANGE_ROUNDS = 100000;
+    vector<long long> wide(raw.begin(), raw.end());
+    BinaryIndexedTree<long long> point(wide);
+    RangeBinaryIndexedTree<long long> range(wide);
+    long long point_sum = 0, range_sum = 0;
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < RANGE_ROUNDS; ++i)
+    {
+        int l = 1 + idx[i] % (n - WIDTH + 1);
+        for (int j = l; j < l + WIDTH; ++j) point.update(j, 1);
+        point_sum += point.query(l + WIDTH - 1) - point.query(l - 1);
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < RANGE_ROUNDS; ++i)
+    {
+        int l = 1 + idx[i] % (n - WIDTH + 1);
+        range.range_add(l, l + WIDTH - 1, 1);
+        range_sum += range.query(l, l + WIDTH - 1);
+    }
+    auto t2 = chrono::high_resolution_clock::now();
+    cout << "range add of " << WIDTH << ": point loop " << ms(t0, t1) * 1e3 / RANGE_ROUNDS << "us"
+         << ", dual tree " << ms(t1, t2) * 1e6 / RANGE_ROUNDS << "ns"
+         << " (checksums " << point_sum << " " << range_sum << ")" << endl;
+
+    // rectangle sums on a 4096 x 4096 grid, one 1D tree per row against the 2D tree
+    constexpr int SIDE = 4096, GRID_ROUNDS = 100000;
+    vector<int> cells((size_t)SIDE * SIDE);
+    for (int &x : cells) x = rng() % 100;
+    auto t3 = chrono::high_resolution_clock::now();
+    vector<BinaryIndexedTree<int>> rows;
+    for (int x = 0; x < SIDE; ++x) rows.emplace_back(vector<int>(cells.begin() + (size_t)x * SIDE, cells.begin() + (size_t)(x + 1) * SIDE));
+    auto t4 = chrono::high_resolution_clock::now();
+    BinaryIndexedTree2D<int> grid(SIDE, SIDE, cells);
+    auto t5 = chrono::high_resolution_clock::now();
+    vector<array<int, 4>> rects(GRID_ROUNDS);
+    for (auto &[x1, y1, x2, y2] : rects)
+    {
+        x1 = 1 + rng() % SIDE, x2 = x1 + rng() % (SIDE - x1 + 1);
+        y1 = 1 + rng() % SIDE, y2 = y1 + rng() % (SIDE - y1 + 1);
+    }
+    long long row_sum = 0, grid_sum = 0;
+    auto t6 = chrono::high_resolution_clock::now();
+    for (auto [x1, y1, x2, y2] : rects)
+        for (int x = x1; x <= x2; ++x) row_sum += rows[x - 1].query(y1, y2);
+    auto t7 = chrono::high_resolution_clock::now();
+    for (auto [x1, y1, x2, y2] : rects) grid_sum += grid.query(x1, y1, x2, y2);
+    auto t8 = chrono::high_resolution_clock::now();
+    cout << SIDE << " x " << SIDE << " grid: build rows " << ms(t3, t4) << "ms, 2D " << ms(t4, t5) << "ms"
+         << ", rectangle by rows " << ms(t6, t7) * 1e3 / GRID_ROUNDS << "us"
+         << ", 2D " << ms(t7, t8) * 1e6 / GRID_ROUNDS << "ns"
+         << " (checksums " << row_sum << " " << grid_sum << ")" << endl;
+    return 0;
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <vector>
-#include <stack>
+#include <algorithm>
+
+#include "csr_graph.hxx"
 
 using namespace std;
 
@@ -23,59 +25,74 @@ struct Node {
     Node() {}
 };
 
-// g is represented by an adjacency list
-vector<int> critical_path(int n, vector<vector<Node>> g, int source, int destination) {
+// the critical path from source to destination, empty if destination can't be reached from source
+// the vertices are visited in topological order by kahn's algorithm, so every edge is looked at a constant number of times
+// earliest goes forward along the order, latest backward, O(n + m) in all
+vector<int> critical_path(const CsrGraph& g, int source, int destination) {
+    int n = g.size();
+
+    // the topological order, a vertex is taken once all its incoming edges are
+    vector<int> indegree(n, 0);
+    for(int v : g.to) ++indegree[v];
+    vector<int> order;
+    order.reserve(n);
+    for(int v = 0; v < n; ++v) {
+        if(indegree[v] == 0) order.push_back(v);
+    }
+    for(size_t i = 0; i < order.size(); ++i) {
+        int u = order[i];
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+            if(--indegree[g.to[e]] == 0) order.push_back(g.to[e]);
+        }
+    }
+
     // find the earliest time
     // earliest time is the max of the earliest time of the previous node and the weight of the edge
-    vector<int> earliest(n, 0);
-    stack<int> s;
-    s.push(source);
+    // -1 for the vertices that can't be reached from source, they pass nothing on
+    vector<int> earliest(n, -1);
     earliest[source] = 0;
-    // dfs
-    while(!s.empty()) {
-        int t = s.top();
-        s.pop();
-        for(auto n: g[t]) {
-            earliest[n.n] = max(earliest[n.n], earliest[t] + n.weight);
-            s.push(n.n);
-        }
+    for(int u : order) {
+        if(earliest[u] == -1) continue;
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) earliest[g.to[e]] = max(earliest[g.to[e]], earliest[u] + g.weight[e]);
     }
+    if(earliest[destination] == -1) return {};
 
     // find the latest time
-    // to do so, we must traverse the graph in reverse order
-    vector<vector<Node>> reversed(n, vector<Node>());
-    for(int i = 0; i < n; ++i) {
-        for(auto n: g[i]) reversed[n.n].push_back(Node(i, n.weight));
-    }
+    // in reverse topological order every successor is done before the vertex itself, so no reversed graph is needed
     constexpr int INF = 0x3f3f3f3f;
     vector<int> latest(n, INF);
-    s.push(destination);
     latest[destination] = earliest[destination];
-    while(!s.empty()) {
-        int t = s.top();
-        s.pop();
-        for(auto n: reversed[t]) {
-            latest[n.n] = min(latest[n.n], latest[t] - n.weight);
-            s.push(n.n);
+    for(auto it = order.rbegin(); it != order.rend(); ++it) {
+        int u = *it;
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+            if(latest[g.to[e]] != INF) latest[u] = min(latest[u], latest[g.to[e]] - g.weight[e]);
         }
     }
 
     // find the critical path
+    // follow an edge that is tight, that is, it decides the earliest time of a vertex with no slack
     vector<int> path;
     int t = source;
     path.push_back(t);
     while(t != destination) {
-        for(auto n: g[t]) {
-            if(earliest[n.n] == latest[n.n]) {
-                path.push_back(n.n);
-                t = n.n;
-                break;
-            }
+        int next = -1;
+        for(int e = g.offset[t]; e < g.offset[t + 1] && next == -1; ++e) {
+            int v = g.to[e];
+            if(earliest[t] + g.weight[e] == earliest[v] && earliest[v] == latest[v]) next = v;
         }
+        // only when g has a cycle, there is no critical path then
+        if(next == -1) return {};
+        path.push_back(next);
+        t = next;
     }
     return path;
 }
 
+// g is represented by an adjacency list, it is converted to a CsrGraph
+vector<int> critical_path(int n, const vector<vector<Node>>& g, int source, int destination) {
+    return critical_path(CsrGraph(g), source, destination);
+}
+
 #ifdef DEBUG
 
 #include <iostream>
@@ -106,6 +123,12 @@ int main() {
     for(auto it: critical_path(n, g, source, destination)) {
         cout << it << " ";
     }
+    cout << endl;
+
+    for(auto it: critical_path(CsrGraph(g), source, destination)) {
+        cout << it << " ";
+    }
+    cout << endl;
 
     return 0;
 }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+// Edge is a directed edge, used to build a CsrGraph from an edge list
+struct Edge {
+    int from;
+    int to;
+    int weight;
+    Edge(int from, int to, int weight) : from(from), to(to), weight(weight) {}
+};
+
+// a graph in compressed sparse row form, all edges live in three flat arrays
+// the edges going out of u are at offset[u]..offset[u + 1] of to and weight
+// so walking the neighbours of u is a linear scan, and there is one allocation per array instead of one per vertex
+// pass it by const reference, nothing is ever copied
+// the graph algorithms that take a CsrGraph include this file, so they all share the one type
+struct CsrGraph {
+    vector<int> offset;
+    vector<int> to;
+    vector<int> weight;
+
+    // a graph without vertices, to be assigned or loaded into later
+    CsrGraph() : offset(1, 0) {}
+
+    // n vertices, the edges keep their relative order within every vertex
+    CsrGraph(int n, const vector<Edge>& es) : offset(n + 1, 0), to(es.size()), weight(es.size()) {
+        // counting sort by from, offset[u + 1] first counts the edges of u, then the prefix sum turns it into the start of u + 1
+        for(const Edge& e : es) ++offset[e.from + 1];
+        for(int u = 0; u < n; ++u) offset[u + 1] += offset[u];
+        vector<int> pos(offset.begin(), offset.end() - 1);
+        for(const Edge& e : es) {
+            to[pos[e.from]] = e.to;
+            weight[pos[e.from]++] = e.weight;
+        }
+    }
+
+    // from an adjacency list, g[u] holds the edges going out of u, anything with n, the other end, and weight
+    // such as the Node of every graph file
+    template<typename Node>
+    explicit CsrGraph(const vector<vector<Node>>& g) : offset(g.size() + 1, 0) {
+        for(size_t u = 0; u < g.size(); ++u) offset[u + 1] = offset[u] + g[u].size();
+        to.reserve(offset.back());
+        weight.reserve(offset.back());
+        for(const auto& edges : g) {
+            for(const Node& e : edges) {
+                to.push_back(e.n);
+                weight.push_back(e.weight);
+            }
+        }
+    }
+
+    int size() const {
+        return offset.size() - 1;
+    }
+
+    // the same graph with every edge turned around
+    CsrGraph reversed() const {
+        vector<Edge> es;
+        es.reserve(to.size());
+        for(int u = 0; u < size(); ++u) {
+            for(int e = offset[u]; e < offset[u + 1]; ++e) es.push_back(Edge(to[e], u, weight[e]));
+        }
+        return CsrGraph(size(), es);
+    }
+};
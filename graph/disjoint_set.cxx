@@ -1,39 +1,55 @@
 #include <vector>
+#include <atomic>
+#include <thread>
 #include <algorithm>
 
+#include "disjoint_set.hxx"
+
 using namespace std;
 
-struct DS {
-    vector<int> fa;
-    // here we use size as the rank to make the tree more balanced
-    // so as to improve performance
-    // there are better ways to do this, but this is the simplest
-    vector<int> rank;
+// a disjoint set that many threads can join and query at once, without locks, after Anderson and Woll
+// a root is linked with a compare and swap on its parent, which fails if another thread linked it first, then it retries from the new roots
+// the sizes can't be updated together with the link, so the root with the smaller index goes under the larger one
+// that keeps the links acyclic, and for elements numbered in random order the trees stay shallow as with union by size
+// find halves the path with compare and swap too, a failed one only means someone else shortened it already
+struct ConcurrentDS {
+    vector<atomic<int>> fa;
 
-    DS(int n) {
-        fa.resize(n);
-        rank.resize(n);
-        for(int i = 0; i < n; i++) fa[i] = i;
-        fill(rank.begin(), rank.end(), 1);
+    ConcurrentDS(int n) : fa(n) {
+        for(int i = 0; i < n; i++) fa[i].store(i, memory_order_relaxed);
     }
 
     int find(int x) {
-        // for root node, fa[x] == x
-        int cur = x;
-        int next = fa[cur];
-        while(cur != next) {
-            cur = next;
-            next = fa[cur];
+        while(true) {
+            int p = fa[x].load(memory_order_acquire);
+            if(p == x) return x;
+            int gp = fa[p].load(memory_order_acquire);
+            if(p != gp) fa[x].compare_exchange_weak(p, gp, memory_order_release, memory_order_relaxed);
+            x = gp;
         }
-        return cur;
     }
 
-    void join(int x, int y) {
-        // we would like to make the tree more balanced
-        // that is, we want fewer nodes at the deeper level
-        if(rank[x] >= rank[y]) swap(x, y);
-        fa[find(x)] = find(y);
-        rank[y] += rank[x];
+    // x and y may be joined by another thread meanwhile, so equal roots are certain but different ones are rechecked
+    bool same(int x, int y) {
+        while(true) {
+            x = find(x);
+            y = find(y);
+            if(x == y) return true;
+            // x is still a root, so they weren't joined when y was found
+            if(fa[x].load(memory_order_acquire) == x) return false;
+        }
+    }
+
+    // returns false if x and y were already joined, exactly one of the threads joining the same two sets gets true
+    bool join(int x, int y) {
+        while(true) {
+            x = find(x);
+            y = find(y);
+            if(x == y) return false;
+            if(x > y) swap(x, y);
+            int expected = x;
+            if(fa[x].compare_exchange_strong(expected, y, memory_order_acq_rel)) return true;
+        }
     }
 };
 
@@ -49,6 +65,97 @@ int main() {
     for(int i = 0; i < 5; i++) {
         cout << ds.find(i) << endl;
     }
+    cout << ds.same(0, 2) << " " << ds.same(2, 3) << " " << ds.join(2, 0) << endl;
+
+    ConcurrentDS cds(5);
+    thread t([&] { cds.join(0, 1); cds.join(1, 2); });
+    cds.join(3, 4);
+    t.join();
+    cout << cds.same(0, 2) << " " << cds.same(2, 3) << endl;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./disjoint_set [n] [unions] [max threads] [old], build with -pthread
+// n elements and random unions between them, 1M each by default
+// the old DS did no path compression and compared the sizes of the arguments instead of the roots,
+// its trees grow about as deep as there are elements, so it is only run with old, 100k of each takes about a second
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+struct LegacyDS {
+    vector<int> fa;
+    vector<int> rank;
+
+    LegacyDS(int n) : fa(n), rank(n, 1) {
+        for(int i = 0; i < n; i++) fa[i] = i;
+    }
+
+    int find(int x) {
+        while(fa[x] != x) x = fa[x];
+        return x;
+    }
+
+    void join(int x, int y) {
+        if(rank[x] >= rank[y]) swap(x, y);
+        fa[find(x)] = find(y);
+        rank[y] += rank[x];
+    }
+};
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? stoi(argv[1]) : 1000000;
+    int unions = argc > 2 ? stoi(argv[2]) : 1000000;
+    int max_threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    mt19937 rng(0);
+    vector<pair<int, int>> es(unions);
+    for(auto& [x, y] : es) x = rng() % n, y = rng() % n;
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+
+    // the count of sets, and a checksum of which elements are in the same set as element 0
+    auto summary = [&](auto& ds) {
+        long long sets = 0, with_zero = 0;
+        for(int i = 0; i < n; i++) {
+            if(ds.find(i) == i) ++sets;
+            if(ds.find(i) == ds.find(0)) with_zero += i;
+        }
+        return make_pair(sets, with_zero);
+    };
+
+    auto t0 = chrono::high_resolution_clock::now();
+    DS ds(n);
+    for(auto [x, y] : es) ds.join(x, y);
+    auto t1 = chrono::high_resolution_clock::now();
+    auto expected = summary(ds);
+    cout << unions << " unions of " << n << " elements: path halving and union by size " << ms(t0, t1) << "ms" << endl;
+    if(argc > 4 && string(argv[4]) == "old") {
+        auto t2 = chrono::high_resolution_clock::now();
+        LegacyDS legacy(n);
+        for(auto [x, y] : es) legacy.join(x, y);
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << "old " << ms(t2, t3) << "ms" << (summary(legacy) == expected ? "" : ", WRONG") << endl;
+    }
+
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        auto t3 = chrono::high_resolution_clock::now();
+        ConcurrentDS cds(n);
+        vector<thread> pool;
+        for(int t = 0; t < threads; t++) {
+            pool.emplace_back([&, t] {
+                for(size_t i = es.size() * t / threads; i < es.size() * (t + 1) / threads; i++) cds.join(es[i].first, es[i].second);
+            });
+        }
+        for(auto& th : pool) th.join();
+        auto t4 = chrono::high_resolution_clock::now();
+        cout << "concurrent, " << threads << " threads: " << ms(t3, t4) << "ms"
+             << (summary(cds) == expected ? "" : ", WRONG") << endl;
+    }
+    return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
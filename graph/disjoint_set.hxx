@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// union by size and path halving, shared by disjoint_set.cxx and minimal_spanning_tree/kruskal.cxx
+struct DS {
+    vector<int> fa;
+    // here we use size as the rank to make the tree more balanced
+    // so as to improve performance
+    // only rank of a root means anything, it is the size of its tree
+    vector<int> rank;
+
+    DS(int n) {
+        fa.resize(n);
+        rank.resize(n);
+        for(int i = 0; i < n; i++) fa[i] = i;
+        fill(rank.begin(), rank.end(), 1);
+    }
+
+    int find(int x) {
+        // for root node, fa[x] == x
+        // path halving, every node on the way is moved up to its grandparent
+        // so the path is half as long the next time, without a second pass or recursion
+        while(fa[x] != x) {
+            fa[x] = fa[fa[x]];
+            x = fa[x];
+        }
+        return x;
+    }
+
+    // find without changing anything, so that many threads may call it at once while nobody joins
+    int root(int x) const {
+        while(fa[x] != x) x = fa[x];
+        return x;
+    }
+
+    bool same(int x, int y) {
+        return find(x) == find(y);
+    }
+
+    // returns false if x and y were already joined
+    bool join(int x, int y) {
+        x = find(x);
+        y = find(y);
+        if(x == y) return false;
+        // we would like to make the tree more balanced
+        // that is, we want fewer nodes at the deeper level, so the smaller tree goes under the larger
+        if(rank[x] > rank[y]) swap(x, y);
+        fa[x] = y;
+        rank[y] += rank[x];
+        return true;
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// a D-ary min heap of vertices by key, with decrease key
+// pos[v] is the index of v in heap, so an entry is lowered in place instead of pushing a second copy,
+// the heap never holds more than n entries, and none of them is stale
+// a larger D makes the heap shallower, so decrease key, which prim and dijkstra do far more often than pop, moves fewer levels
+// with D = 4, the children of a node sit next to each other, so a sift down reads one cache line per level
+// shared by the 4-ary queue of dijkstra and by indexed_prim
+template<int D = 4>
+struct IndexedHeap {
+    vector<int> heap;
+    // -1 when v isn't in the heap
+    vector<int> pos;
+    vector<int> key;
+    IndexedHeap(int n) : pos(n, -1), key(n) {}
+    // insert v, or lower its key, returns false if v already had a key no larger than k
+    bool push(int v, int k) {
+        if(pos[v] == -1) {
+            pos[v] = heap.size();
+            heap.push_back(v);
+        } else if(k >= key[v]) {
+            return false;
+        }
+        key[v] = k;
+        sift_up(pos[v]);
+        return true;
+    }
+    // remove and return the vertex with the smallest key, key[v] still holds its key afterwards
+    int pop() {
+        int v = heap[0];
+        pos[v] = -1;
+        int last = heap.back();
+        heap.pop_back();
+        if(!heap.empty()) {
+            heap[0] = last;
+            pos[last] = 0;
+            sift_down(0);
+        }
+        return v;
+    }
+    bool empty() const { return heap.empty(); }
+
+private:
+    void sift_up(int i) {
+        int v = heap[i];
+        while(i > 0 && key[heap[(i - 1) / D]] > key[v]) {
+            heap[i] = heap[(i - 1) / D];
+            pos[heap[i]] = i;
+            i = (i - 1) / D;
+        }
+        heap[i] = v;
+        pos[v] = i;
+    }
+    void sift_down(int i) {
+        int v = heap[i];
+        int n = heap.size();
+        while(true) {
+            int best = -1;
+            for(int c = D * i + 1; c < min(D * i + D + 1, n); ++c) {
+                if(best == -1 || key[heap[c]] < key[heap[best]]) best = c;
+            }
+            if(best == -1 || key[heap[best]] >= key[v]) break;
+            heap[i] = heap[best];
+            pos[heap[i]] = i;
+            i = best;
+        }
+        heap[i] = v;
+        pos[v] = i;
+    }
+};
@@ -2,18 +2,520 @@
 #include <vector>
 #include <queue>
 #include <tuple>
+#include <algorithm>
+#include <climits>
+#include <functional>
 
 using namespace std;
 
+// cur is the flow on the edge, cost is per unit of flow, only min_cost_flow looks at it
 struct E {
     int from;
     int to;
     int cap;
     int cur;
-    E(int f, int t, int c, int cur): from(f), to(t), cap(c), cur(cur) {}
-    E(): from(-1), to(-1), cap(-1), cur(-1) {}
+    int cost;
+    E(int f, int t, int c, int cur, int cost = 0): from(f), to(t), cap(c), cur(cur), cost(cost) {}
+    E(): from(-1), to(-1), cap(-1), cur(-1), cost(0) {}
 };
 
+// a flow network, every edge is stored next to its reverse, es[i ^ 1] is the reverse of es[i]
+// the reverse has capacity 0, the negated flow and the negated cost, so the residual capacity of both is cap - cur,
+// and pushing f along i is es[i].cur += f, es[i ^ 1].cur -= f, no search for the reverse is ever needed
+// the algorithms run on a copy in adjacency array form, where the edges going out of u are at offset[u]..offset[u + 1],
+// and rev[k] is the position of the reverse of edge k, so scanning the edges of a vertex reads memory in order
+// the flow is written back to es after every run, so the algorithms can be run again after adding edges, and continue from the flow there is
+struct FlowNetwork {
+    int n;
+    vector<E> es;
+
+    FlowNetwork(int n) : n(n) {}
+
+    // returns the index of the edge, its flow is es[i].cur after a run
+    int add_edge(int from, int to, int cap, int cost = 0) {
+        es.push_back(E(from, to, cap, 0, cost));
+        es.push_back(E(to, from, 0, 0, -cost));
+        offset.clear();
+        return es.size() - 2;
+    }
+
+    // remove all flow
+    void reset() {
+        for(E& e : es) e.cur = 0;
+    }
+
+    // dinic, O(V^2 E) but far faster in practice, O(E sqrt(V)) on unit capacities
+    // it needs a phase for every length of augmenting path, so on deep networks push_relabel is usually faster
+    // a bfs from the source labels every vertex with its distance in the residual network,
+    // then a blocking flow is found along edges that go exactly one level up
+    // every vertex keeps its current arc, the edges before it are known to be useless in this phase, so each is tried once
+    long long dinic(int source, int sink) {
+        // nothing flows from a vertex to itself, and the phases below would never end
+        if(source == sink) return 0;
+        load();
+        long long flow = 0;
+        vector<int> level(n), it(n), q(n), at(n + 1), by(n + 1);
+        vector<long long> limit(n + 1), sent(n + 1);
+        while(true) {
+            // bfs levels, the distance to the sink, so that the dfs below only ever walks towards it
+            fill(level.begin(), level.end(), -1);
+            int qh = 0, qt = 0;
+            level[sink] = 0;
+            q[qt++] = sink;
+            while(qh < qt && level[source] == -1) {
+                int v = q[qh++];
+                for(int k = offset[v]; k < offset[v + 1]; ++k) {
+                    // rev[k] goes from to[k] into v
+                    if(res[rev[k]] > 0 && level[to[k]] == -1) {
+                        level[to[k]] = level[v] + 1;
+                        q[qt++] = to[k];
+                    }
+                }
+            }
+            if(level[source] == -1) break;
+
+            // the blocking flow, by a dfs that sends as much as it can from every vertex before going back,
+            // so paths with a common prefix are found in one go, and every edge on the prefix is updated once
+            // it is iterative, the levels may be as many as the vertices
+            // frame d is at vertex at[d], entered by edge by[d], may send up to limit[d] and has sent sent[d]
+            for(int u = 0; u < n; ++u) it[u] = offset[u];
+            int d = 0;
+            at[0] = source;
+            limit[0] = LLONG_MAX;
+            sent[0] = 0;
+            while(true) {
+                int u = at[d];
+                if(u != sink && sent[d] < limit[d]) {
+                    int& k = it[u];
+                    while(k < offset[u + 1] && !(res[k] > 0 && level[to[k]] == level[u] - 1)) ++k;
+                    if(k < offset[u + 1]) {
+                        ++d;
+                        at[d] = to[k];
+                        by[d] = k;
+                        limit[d] = min(limit[d - 1] - sent[d - 1], (long long)res[k]);
+                        sent[d] = 0;
+                        continue;
+                    }
+                    // u can't send anymore in this phase
+                    level[u] = -1;
+                }
+                if(u == sink) sent[d] = limit[d];
+                if(d == 0) break;
+                // back to the parent with what got through
+                int k = by[d];
+                res[k] -= sent[d];
+                res[rev[k]] += sent[d];
+                sent[d - 1] += sent[d];
+                --d;
+            }
+            flow += sent[0];
+        }
+        store();
+        return flow;
+    }
+
+    // highest label push relabel, O(V^2 sqrt(E))
+    // every vertex holds a height, and may only push its excess to a neighbour exactly one lower
+    // the active vertex with the highest label is always the one discharged,
+    // a vertex that can't push anymore is relabelled to one above its lowest residual neighbour
+    // if no vertex is left at some height below n, those above it can't reach the sink, and are lifted above n at once, the gap heuristic
+    // heights are also recomputed by a bfs from the sink and source once the relabels have scanned about 6n + m / 2 edges, the global relabel
+    // vertices above n send their excess back to the source, so at the end the edges hold a real flow, not just a preflow
+    long long push_relabel(int source, int sink) {
+        if(source == sink) return 0;
+        load();
+        height.assign(n, 0);
+        excess.assign(n, 0);
+        it.assign(n, 0);
+        active.assign(2 * n + 1, {});
+        next.assign(n, -1);
+        prev.assign(n, -1);
+        head.assign(n, -1);
+        this->source = source;
+        this->sink = sink;
+
+        for(int k = offset[source]; k < offset[source + 1]; ++k) {
+            int f = res[k];
+            if(f <= 0) continue;
+            res[k] -= f;
+            res[rev[k]] += f;
+            excess[to[k]] += f;
+            excess[source] -= f;
+        }
+        global_relabel();
+        // the edges scanned by relabels since the last global relabel
+        long long work = 0;
+        while(highest >= 0) {
+            if(active[highest].empty()) {
+                --highest;
+                continue;
+            }
+            int u = active[highest].back();
+            active[highest].pop_back();
+            // stale, u was lifted by a gap, or already discharged
+            if(height[u] != highest || excess[u] == 0) continue;
+            while(excess[u] > 0) {
+                int k = it[u];
+                if(k == offset[u + 1]) {
+                    work += relabel(u);
+                    if(work > 6LL * n + (long long)es.size() / 2) {
+                        work = 0;
+                        global_relabel();
+                        break;
+                    }
+                    continue;
+                }
+                int v = to[k];
+                if(res[k] > 0 && height[u] == height[v] + 1) {
+                    int f = min<long long>(excess[u], res[k]);
+                    res[k] -= f;
+                    res[rev[k]] += f;
+                    excess[u] -= f;
+                    if(excess[v] == 0) activate(v);
+                    excess[v] += f;
+                } else {
+                    ++it[u];
+                }
+            }
+        }
+        store();
+        return excess[sink];
+    }
+
+    // successive shortest paths, returns the flow and its cost, the flow is at most limit
+    // every round sends flow along the cheapest paths from the source to the sink in the residual network, until there is none
+    // the paths are found by dijkstra on the reduced costs cost + h[u] - h[v], which are never negative,
+    // and h grows by the distances after every round, the potentials of johnson, so reverse edges don't break dijkstra
+    // dijkstra stops as soon as it reaches the sink, a bellman ford gives the first h if some residual edge has a negative cost
+    // then all paths of the same cost are sent at once, by a dfs over the edges of reduced cost 0, like dinic over its levels
+    // the flow already in the edges must be the cheapest one of its value, with no flow at all that means no negative cycle
+    pair<long long, long long> min_cost_flow(int source, int sink, long long limit = LLONG_MAX) {
+        // nothing flows from a vertex to itself, the dfs below would take the source for the sink
+        if(source == sink) return {0, 0};
+        load();
+        constexpr long long INF = LLONG_MAX / 4;
+        vector<long long> h(n, 0), dist(n);
+        bool negative = false;
+        for(int k = 0; k < (int)res.size(); ++k) negative |= res[k] > 0 && cost[k] < 0;
+        if(negative) {
+            // spfa from the source, the vertices it can't reach never get on a path
+            fill(dist.begin(), dist.end(), INF);
+            vector<char> in_queue(n, false);
+            queue<int> q;
+            dist[source] = 0;
+            q.push(source);
+            while(!q.empty()) {
+                int u = q.front();
+                q.pop();
+                in_queue[u] = false;
+                for(int k = offset[u]; k < offset[u + 1]; ++k) {
+                    if(res[k] > 0 && dist[to[k]] > dist[u] + cost[k]) {
+                        dist[to[k]] = dist[u] + cost[k];
+                        if(!in_queue[to[k]]) {
+                            in_queue[to[k]] = true;
+                            q.push(to[k]);
+                        }
+                    }
+                }
+            }
+            for(int v = 0; v < n; ++v) h[v] = dist[v] == INF ? 0 : dist[v];
+        }
+
+        long long flow = 0, total = 0;
+        // state 1 for a vertex on the dfs stack, 2 for one that can't send more this round
+        vector<int> it(n), at(n + 1), by(n + 1);
+        vector<char> state(n);
+        vector<long long> want(n + 1), sent(n + 1);
+        while(flow < limit) {
+            fill(dist.begin(), dist.end(), INF);
+            priority_queue<pair<long long, int>, vector<pair<long long, int>>, greater<pair<long long, int>>> pq;
+            dist[source] = 0;
+            pq.push({0, source});
+            while(!pq.empty()) {
+                auto [d, u] = pq.top();
+                pq.pop();
+                if(d > dist[u]) continue;
+                if(u == sink) break;
+                for(int k = offset[u]; k < offset[u + 1]; ++k) {
+                    int v = to[k];
+                    long long nd = d + cost[k] + h[u] - h[v];
+                    if(res[k] > 0 && nd < dist[v]) {
+                        dist[v] = nd;
+                        pq.push({nd, v});
+                    }
+                }
+            }
+            if(dist[sink] == INF) break;
+            // dijkstra stops at the sink, every vertex not settled by then is at least as far, so it gets dist[sink]
+            // that still keeps the reduced costs from being negative
+            for(int v = 0; v < n; ++v) h[v] += min(dist[v], dist[sink]);
+
+            // send along the edges of reduced cost 0, the same dfs as dinic, frames at[d], by[d], want[d], sent[d]
+            // those edges may form cycles of cost 0, so a vertex on the stack is never entered again
+            for(int u = 0; u < n; ++u) it[u] = offset[u];
+            fill(state.begin(), state.end(), 0);
+            int d = 0;
+            at[0] = source;
+            want[0] = limit - flow;
+            sent[0] = 0;
+            state[source] = 1;
+            while(true) {
+                int u = at[d];
+                if(u != sink && sent[d] < want[d]) {
+                    int& k = it[u];
+                    while(k < offset[u + 1] && !(res[k] > 0 && state[to[k]] == 0 && cost[k] + h[u] - h[to[k]] == 0)) ++k;
+                    if(k < offset[u + 1]) {
+                        ++d;
+                        at[d] = to[k];
+                        by[d] = k;
+                        want[d] = min(want[d - 1] - sent[d - 1], (long long)res[k]);
+                        sent[d] = 0;
+                        state[to[k]] = 1;
+                        continue;
+                    }
+                }
+                if(u == sink) sent[d] = want[d];
+                state[u] = sent[d] < want[d] ? 2 : 0;
+                if(d == 0) break;
+                int k = by[d];
+                res[k] -= sent[d];
+                res[rev[k]] += sent[d];
+                sent[d - 1] += sent[d];
+                --d;
+            }
+            flow += sent[0];
+            // every unit went along a path of cost h[sink] - h[source]
+            total += sent[0] * (h[sink] - h[source]);
+        }
+        store();
+        return {flow, total};
+    }
+
+    // after a max flow from source, by any of the above, the vertices on the source side of a min cut
+    // they are the ones the source still reaches in the residual network, every edge from them to the rest is full,
+    // and the capacities of those edges add up to the flow
+    vector<int> min_cut(int source) {
+        load();
+        vector<char> seen(n, false);
+        vector<int> side = {source};
+        seen[source] = true;
+        for(size_t i = 0; i < side.size(); ++i) {
+            int u = side[i];
+            for(int k = offset[u]; k < offset[u + 1]; ++k) {
+                if(res[k] > 0 && !seen[to[k]]) {
+                    seen[to[k]] = true;
+                    side.push_back(to[k]);
+                }
+            }
+        }
+        return side;
+    }
+
+private:
+    // the adjacency array, empty until the first run after an edge was added
+    vector<int> offset;
+    vector<int> to;
+    vector<int> rev;
+    vector<int> cost;
+    // the residual capacity
+    vector<int> res;
+    // pos[i] is where es[i] is in the adjacency array
+    vector<int> pos;
+
+    // build the adjacency array if an edge was added, a counting sort of the edges by from, and copy the residual capacities
+    void load() {
+        if(offset.empty()) {
+            offset.assign(n + 1, 0);
+            for(const E& e : es) ++offset[e.from + 1];
+            for(int u = 0; u < n; ++u) offset[u + 1] += offset[u];
+            to.resize(es.size());
+            rev.resize(es.size());
+            cost.resize(es.size());
+            res.resize(es.size());
+            pos.resize(es.size());
+            vector<int> next_pos(offset.begin(), offset.end() - 1);
+            for(size_t i = 0; i < es.size(); ++i) {
+                pos[i] = next_pos[es[i].from]++;
+                to[pos[i]] = es[i].to;
+                cost[pos[i]] = es[i].cost;
+            }
+            for(size_t i = 0; i < es.size(); ++i) rev[pos[i]] = pos[i ^ 1];
+        }
+        for(size_t i = 0; i < es.size(); ++i) res[pos[i]] = es[i].cap - es[i].cur;
+    }
+
+    void store() {
+        for(size_t i = 0; i < es.size(); ++i) es[i].cur = es[i].cap - res[pos[i]];
+    }
+
+    // the state of push_relabel
+    int source;
+    int sink;
+    vector<int> height;
+    vector<long long> excess;
+    vector<int> it;
+    // active[h] holds the vertices with excess at height h, entries may be stale
+    vector<vector<int>> active;
+    int highest;
+    // all vertices below n, by height, as doubly linked lists, to find gaps and lift what is above them
+    vector<int> next;
+    vector<int> prev;
+    vector<int> head;
+    int highest_listed;
+
+    void activate(int v) {
+        if(v == source || v == sink) return;
+        active[height[v]].push_back(v);
+        highest = max(highest, height[v]);
+    }
+
+    void list_insert(int v) {
+        int h = height[v];
+        prev[v] = -1;
+        next[v] = head[h];
+        if(head[h] != -1) prev[head[h]] = v;
+        head[h] = v;
+        highest_listed = max(highest_listed, h);
+    }
+
+    void list_erase(int v) {
+        int h = height[v];
+        if(prev[v] != -1) next[prev[v]] = next[v];
+        else head[h] = next[v];
+        if(next[v] != -1) prev[next[v]] = prev[v];
+    }
+
+    // returns the count of edges scanned
+    int relabel(int u) {
+        int old = height[u];
+        int h = 2 * n;
+        for(int k = offset[u]; k < offset[u + 1]; ++k) {
+            if(res[k] > 0) h = min(h, height[to[k]] + 1);
+        }
+        it[u] = offset[u];
+        if(old < n) {
+            list_erase(u);
+            if(head[old] == -1) {
+                // a gap at old, nothing above it can reach the sink
+                for(int k = old + 1; k <= highest_listed; ++k) {
+                    for(int v = head[k]; v != -1; v = next[v]) {
+                        height[v] = n + 1;
+                        it[v] = offset[v];
+                        if(excess[v] > 0) activate(v);
+                    }
+                    head[k] = -1;
+                }
+                highest_listed = old - 1;
+                h = max(h, n + 1);
+            }
+        }
+        height[u] = h;
+        if(h < n) list_insert(u);
+        return offset[u + 1] - offset[u] + 12;
+    }
+
+    // exact heights, the distance to the sink in the residual network, or n plus the distance to the source
+    void global_relabel() {
+        fill(height.begin(), height.end(), 2 * n);
+        vector<int> q(n);
+        auto bfs = [&](int from, int base) {
+            int qh = 0, qt = 0;
+            height[from] = base;
+            q[qt++] = from;
+            while(qh < qt) {
+                int v = q[qh++];
+                for(int k = offset[v]; k < offset[v + 1]; ++k) {
+                    // rev[k] goes from to[k] into v
+                    int u = to[k];
+                    if(height[u] == 2 * n && res[rev[k]] > 0) {
+                        height[u] = height[v] + 1;
+                        q[qt++] = u;
+                    }
+                }
+            }
+        };
+        bfs(sink, 0);
+        if(height[source] == 2 * n) bfs(source, n);
+        else height[source] = n;
+        for(auto& a : active) a.clear();
+        fill(head.begin(), head.end(), -1);
+        highest = -1;
+        highest_listed = -1;
+        for(int v = 0; v < n; ++v) {
+            it[v] = offset[v];
+            if(v == source || v == sink) continue;
+            if(height[v] < n) list_insert(v);
+            if(excess[v] > 0) activate(v);
+        }
+    }
+};
+
+#ifdef DEBUG
+
+int main() {
+    FlowNetwork g(6);
+    g.add_edge(0, 1, 16);
+    g.add_edge(0, 3, 13);
+    g.add_edge(1, 2, 12);
+    g.add_edge(2, 3, 9);
+    g.add_edge(3, 1, 4);
+    g.add_edge(3, 4, 14);
+    g.add_edge(4, 2, 7);
+    g.add_edge(4, 5, 4);
+    g.add_edge(2, 5, 20);
+    long long total = g.dinic(0, 5);
+    for(size_t i = 0; i < g.es.size(); i += 2) {
+        E e = g.es[i];
+        if(e.cur == 0) {
+        continue;
+        }
+        cout << e.from << " " << e.to << " " << e.cur << endl;
+    }
+    cout << total << endl;
+
+    g.reset();
+    cout << g.push_relabel(0, 5) << endl;
+    // any source and sink
+    g.reset();
+    cout << g.dinic(3, 2) << " " << (g.reset(), g.push_relabel(3, 2)) << endl;
+    cout << g.dinic(1, 1) << " " << g.push_relabel(1, 1) << endl;
+
+    // the source side of the min cut, the edges out of it add up to the flow
+    g.reset();
+    g.dinic(0, 5);
+    for(int v : g.min_cut(0)) cout << v << " ";
+    cout << endl;
+
+    // two routes from 0 to 3, the cheaper one is full first
+    FlowNetwork c(4);
+    c.add_edge(0, 1, 2, 1);
+    c.add_edge(1, 3, 2, 1);
+    c.add_edge(0, 2, 3, 2);
+    c.add_edge(2, 3, 3, 2);
+    c.add_edge(1, 2, 1, -1);
+    auto [flow, cost] = c.min_cost_flow(0, 3);
+    cout << flow << " " << cost << endl;
+    auto [self_flow, self_cost] = c.min_cost_flow(1, 1);
+    cout << self_flow << " " << self_cost << endl;
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./max_flow [layered|random|cost] [n] [m]
+// layered: n vertices in layers of 1000 or fewer, every edge goes from one layer to the next, 100k vertices and 1M edges by default
+// random: random edges between n vertices, source 0 and sink n - 1, 100k vertices and 1M edges by default
+// the old edmonds karp below rebuilt the residual network and a V x V matrix on every augmentation,
+// so it only runs on a network of 500 vertices and 5000 edges first
+// cost: min_cost_flow on random edges with costs in [0, 1000), 10k vertices and 100k edges by default,
+// against successive shortest paths with spfa and one path per search
+
+#include <chrono>
+#include <random>
+#include <string>
+
 // O(E)
 vector<E> get_residual(const vector<E> origin) {
     vector<E> residual;
@@ -92,31 +594,127 @@ bool increase_flow(vector<E>& g, int n) {
     return true;
 }
 
-int main() {
-    vector<E> flows;
-    flows.push_back({0, 1, 16, 0});
-    flows.push_back({0, 3, 13, 0});
-    flows.push_back({1, 2, 12, 0});
-    flows.push_back({2, 3, 9, 0});
-    flows.push_back({3, 1, 4, 0});
-    flows.push_back({3, 4, 14, 0});
-    flows.push_back({4, 2, 7, 0});
-    flows.push_back({4, 5, 4, 0});
-    flows.push_back({2, 5, 20, 0});
-    // O(V E ** 2)
-    while (increase_flow(flows, 6)) {}
-    for(E e: flows) {
-        if(e.cur == 0) {
-        continue;
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "layered";
+    int n = argc > 2 ? stoi(argv[2]) : mode == "cost" ? 10000 : 100000;
+    int m = argc > 3 ? stoi(argv[3]) : mode == "cost" ? 100000 : 1000000;
+    mt19937 rng(0);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    if(mode == "cost") {
+        FlowNetwork g(n);
+        for(int i = 0; i < m; ++i) g.add_edge(rng() % n, rng() % n, 1 + rng() % 100, rng() % 1000);
+        auto t0 = chrono::high_resolution_clock::now();
+        auto [flow, cost] = g.min_cost_flow(0, n - 1);
+        auto t1 = chrono::high_resolution_clock::now();
+        vector<int> side = g.min_cut(0);
+        auto t2 = chrono::high_resolution_clock::now();
+
+        // the plain version, on its own copy of the residual network
+        vector<vector<int>> adj(n);
+        vector<E> r;
+        for(size_t i = 0; i < g.es.size(); ++i) {
+            adj[g.es[i].from].push_back(i);
+            r.push_back(E(g.es[i].from, g.es[i].to, g.es[i].cap, 0, g.es[i].cost));
         }
-        cout << e.from << " " << e.to << " " << e.cur << endl;
+        long long plain_flow = 0, plain_cost = 0;
+        while(true) {
+            vector<long long> dist(n, LLONG_MAX);
+            vector<int> by(n, -1);
+            vector<char> in_queue(n, false);
+            queue<int> q;
+            dist[0] = 0;
+            q.push(0);
+            while(!q.empty()) {
+                int u = q.front();
+                q.pop();
+                in_queue[u] = false;
+                for(int i : adj[u]) {
+                    if(r[i].cap > r[i].cur && dist[r[i].to] > dist[u] + r[i].cost) {
+                        dist[r[i].to] = dist[u] + r[i].cost;
+                        by[r[i].to] = i;
+                        if(!in_queue[r[i].to]) {
+                            in_queue[r[i].to] = true;
+                            q.push(r[i].to);
+                        }
+                    }
+                }
+            }
+            if(dist[n - 1] == LLONG_MAX) break;
+            int f = INT_MAX;
+            for(int v = n - 1; v != 0; v = r[by[v]].from) f = min(f, r[by[v]].cap - r[by[v]].cur);
+            for(int v = n - 1; v != 0; v = r[by[v]].from) {
+                r[by[v]].cur += f;
+                r[by[v] ^ 1].cur -= f;
+            }
+            plain_flow += f;
+            plain_cost += f * dist[n - 1];
+        }
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << n << " vertices, " << m << " edges: min cost flow " << ms(t0, t1) << "ms"
+             << ", min cut " << ms(t1, t2) << "ms, " << side.size() << " vertices on the source side"
+             << ", spfa one path at a time " << ms(t2, t3) << "ms"
+             << (flow == plain_flow && cost == plain_cost ? "" : ", WRONG") << endl;
+        return 0;
     }
-    int total = 0;
-    for(E e: flows) {
-        if(e.from == 0) {
-        total += e.cur;
+    auto make = [&](int n, int m) {
+        vector<E> es;
+        if(mode == "layered") {
+            // layers of 1000 vertices, or of a tenth of them on a small network
+            const int WIDTH = max(1, min(1000, (n - 2) / 10));
+            int layers = max(1, (n - 2) / WIDTH);
+            // vertex 0 is the source, vertex n - 1 the sink, layer l is the vertices 1 + l * WIDTH .. (l + 1) * WIDTH
+            // the source feeds the first layer and the last one feeds the sink, vertices past the last full layer are left out
+            for(int i = 1; i <= WIDTH; ++i) {
+                es.push_back(E(0, i, 1000000, 0));
+                es.push_back(E((layers - 1) * WIDTH + i, n - 1, 1000000, 0));
+            }
+            for(int i = 0; i < m; ++i) {
+                int layer = rng() % max(1, layers - 1);
+                int u = 1 + layer * WIDTH + rng() % WIDTH, v = 1 + min(layer + 1, layers - 1) * WIDTH + rng() % WIDTH;
+                es.push_back(E(u, v, 1 + rng() % 1000, 0));
+            }
+        } else {
+            for(int i = 0; i < m; ++i) es.push_back(E(rng() % n, rng() % n, 1 + rng() % 1000, 0));
+        }
+        return es;
+    };
+    auto run = [&](const vector<E>& es, int n) {
+        FlowNetwork g(n);
+        for(const E& e : es) g.add_edge(e.from, e.to, e.cap);
+        auto t0 = chrono::high_resolution_clock::now();
+        long long a = g.dinic(0, n - 1);
+        auto t1 = chrono::high_resolution_clock::now();
+        g.reset();
+        long long b = g.push_relabel(0, n - 1);
+        auto t2 = chrono::high_resolution_clock::now();
+        cout << mode << ", " << n << " vertices, " << es.size() << " edges: dinic " << ms(t0, t1) << "ms"
+             << ", push relabel " << ms(t1, t2) << "ms" << (a == b ? "" : ", WRONG") << endl;
+        return a;
+    };
+
+    // the old code keeps one capacity per ordered pair of vertices, and mixes up parallel and opposite edges,
+    // so the small network keeps only the first edge between any two vertices
+    vector<E> small;
+    {
+        vector<vector<char>> seen(500, vector<char>(500, false));
+        for(const E& e : make(500, 5000)) {
+            if(e.from == e.to || seen[e.from][e.to]) continue;
+            seen[e.from][e.to] = seen[e.to][e.from] = true;
+            small.push_back(e);
         }
     }
-    cout << total << endl;
+    long long expected = run(small, 500);
+    auto t0 = chrono::high_resolution_clock::now();
+    vector<E> flows = small;
+    while (increase_flow(flows, 500)) {}
+    auto t1 = chrono::high_resolution_clock::now();
+    long long total = 0;
+    for(E e: flows) {
+        if(e.from == 0) total += e.cur;
+    }
+    cout << "edmonds karp " << ms(t0, t1) << "ms" << (total == expected ? "" : ", WRONG") << endl;
+    run(make(n, m), n);
     return 0;
 }
+
+#endif
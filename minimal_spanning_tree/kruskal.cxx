@@ -1,33 +1,14 @@
 #include <vector>
+#include <thread>
+#include <random>
+#include <cstdint>
+#include <algorithm>
 
-using namespace std;
-
-struct DS {
-    vector<int> fa, rank;
-    DS(int n) {
-        fa.assign(n, 0); rank.assign(n, 1);
-        for(int i = 0; i < n; ++i) fa[i] = i;
-    }
-    int find(int x) {
-        int cur = x, next = fa[cur];
-        while(cur != next) {
-            cur = next; next = fa[cur];
-        }
-        return cur;
-    }
-    void join(int x, int y) {
-        if(rank[x] >= rank[y]) swap(x, y);
-        rank[y] += rank[x]; fa[find(x)] = find(y);
-    }
-};
+#include "../graph/csr_graph.hxx"
+#include "../graph/disjoint_set.hxx"
+#include "../misc/barrier.hxx"
 
-struct Edge {
-    int from, to, weight;
-    Edge(int from, int to, int weight) : from(from), to(to), weight(weight) {}
-    bool operator<(const Edge& rhs) const {
-        return weight < rhs.weight;
-    }
-};
+using namespace std;
 
 // g is represented by edge list
 vector<Edge> kruskal(vector<Edge> g, int n) {
@@ -36,7 +17,7 @@ vector<Edge> kruskal(vector<Edge> g, int n) {
     
     // sort the edges by weight
     // from the least to the most
-    sort(g.begin(), g.end());
+    sort(g.begin(), g.end(), [](const Edge& a, const Edge& b) { return a.weight < b.weight; });
     for(auto e: g) {
         // if the edge connects two different components
         // then it must be in the mst
@@ -49,6 +30,129 @@ vector<Edge> kruskal(vector<Edge> g, int n) {
     return mst;
 }
 
+// sort the edges by weight with an LSD radix sort, 8 bits per pass, buf is the scratch space of the same size
+// the sign bit is flipped so that negative weights come first
+// a pass in which every weight has the same byte would only copy, so it is skipped
+void radix_sort(Edge* first, Edge* last, Edge* buf) {
+    size_t n = last - first;
+    auto key = [](const Edge& e) { return (uint32_t)e.weight ^ 0x80000000u; };
+    size_t count[4][256] = {};
+    for(Edge* e = first; e != last; ++e) {
+        uint32_t k = key(*e);
+        for(int pass = 0; pass < 4; ++pass) ++count[pass][(k >> (pass * 8)) & 255];
+    }
+    Edge* from = first;
+    Edge* to = buf;
+    for(int pass = 0; pass < 4; ++pass) {
+        if(count[pass][(key(*first) >> (pass * 8)) & 255] == n) continue;
+        size_t pos[256];
+        size_t sum = 0;
+        for(int b = 0; b < 256; ++b) {
+            pos[b] = sum;
+            sum += count[pass][b];
+        }
+        for(Edge* e = from; e != from + n; ++e) to[pos[(key(*e) >> (pass * 8)) & 255]++] = *e;
+        swap(from, to);
+    }
+    if(from != first) copy(from, from + n, first);
+}
+
+// move the edges in [l, r) for which keep is true to the front, in order, and return how many there are
+// with rest, the others follow them, otherwise they are dropped
+// the range is split into one chunk per thread, each thread marks its chunk, then writes it to buf at offsets from the counts, then copies back
+// the chunks run on the workers of pool, which the caller starts once for all partitions
+template<typename Keep>
+size_t parallel_partition(vector<Edge>& g, vector<Edge>& buf, size_t l, size_t r, Keep keep, bool rest, WorkerPool& pool) {
+    // small ranges aren't worth waking the workers for, they get fewer chunks, and one runs on the calling thread
+    constexpr size_t GRAIN = 1 << 16;
+    int threads = max(1, min<int>(pool.size(), (r - l) / GRAIN));
+    vector<size_t> begin(threads + 1), kept(threads, 0);
+    for(int t = 0; t <= threads; ++t) begin[t] = l + (r - l) * t / threads;
+    vector<char> flag(r - l);
+    auto run = [&](auto work) {
+        if(threads == 1) work(0);
+        else pool.run([&](int t) {
+            if(t < threads) work(t);
+        });
+    };
+
+    run([&](int t) {
+        size_t c = 0;
+        for(size_t i = begin[t]; i < begin[t + 1]; ++i) c += flag[i - l] = keep(g[i]);
+        kept[t] = c;
+    });
+    size_t total = 0;
+    vector<size_t> front(threads), back(threads);
+    for(int t = 0; t < threads; ++t) {
+        front[t] = l + total;
+        total += kept[t];
+    }
+    size_t dropped = 0;
+    for(int t = 0; t < threads; ++t) {
+        back[t] = l + total + dropped;
+        dropped += begin[t + 1] - begin[t] - kept[t];
+    }
+    run([&](int t) {
+        size_t f = front[t], b = back[t];
+        for(size_t i = begin[t]; i < begin[t + 1]; ++i) {
+            if(flag[i - l]) buf[f++] = g[i];
+            else if(rest) buf[b++] = g[i];
+        }
+    });
+    size_t end = rest ? r : l + total;
+    run([&](int t) {
+        size_t a = l + (end - l) * t / threads, b = l + (end - l) * (t + 1) / threads;
+        copy(buf.begin() + a, buf.begin() + b, g.begin() + a);
+    });
+    return total;
+}
+
+// filter kruskal, by Osipov, Sanders and Singler
+// like quick sort, the edges are split around a pivot weight, and the lighter ones are handled first
+// then every heavier edge whose ends are already in the same component can't be in the mst, and is dropped before it is ever sorted
+// on a dense graph most edges are dropped that way, so only about the lightest n log(m / n) edges get sorted
+// ranges of at most n edges are radix sorted and scanned like kruskal
+// the partition and the filter are split across threads, the finds done while filtering change nothing, so they can run at the same time
+// the edges are copied once into g, which is partitioned and sorted in place, and buf is the scratch space of the same size
+vector<Edge> filter_kruskal(const vector<Edge>& edges, int n, int threads = 1) {
+    DS ds(n);
+    vector<Edge> mst;
+    vector<Edge> g(edges);
+    vector<Edge> buf(g.size(), Edge(0, 0, 0));
+    mt19937 rng(0);
+    const size_t threshold = max(n, 1024);
+    WorkerPool pool(max(1, threads));
+
+    auto solve = [&](auto& self, size_t l, size_t r) -> void {
+        if(l == r || (int)mst.size() == n - 1) return;
+        if(r - l > threshold) {
+            // the median of three random weights
+            int a = g[l + rng() % (r - l)].weight, b = g[l + rng() % (r - l)].weight, c = g[l + rng() % (r - l)].weight;
+            int pivot = max(min(a, b), min(max(a, b), c));
+            size_t mid = l + parallel_partition(g, buf, l, r, [pivot](const Edge& e) { return e.weight <= pivot; }, true, pool);
+            // when the pivot is the heaviest weight in the range, nothing is split off, so the range is radix sorted as a whole
+            // splitting off the edges equal to the pivot instead costs two more partitions, which is slower than the sort on such ranges
+            if(mid != r) {
+                self(self, l, mid);
+                if((int)mst.size() == n - 1) return;
+                size_t end = mid + parallel_partition(g, buf, mid, r, [&ds](const Edge& e) { return ds.root(e.from) != ds.root(e.to); }, false, pool);
+                self(self, mid, end);
+                return;
+            }
+        }
+        radix_sort(g.data() + l, g.data() + r, buf.data() + l);
+        for(size_t i = l; i < r && (int)mst.size() < n - 1; ++i) {
+            const Edge& e = g[i];
+            if(ds.find(e.from) != ds.find(e.to)) {
+                mst.push_back(e);
+                ds.join(e.from, e.to);
+            }
+        }
+    };
+    solve(solve, 0, g.size());
+    return mst;
+}
+
 #ifdef DEBUG
 
 #include <iostream>
@@ -65,6 +169,52 @@ int main() {
     for(auto e: mst) {
         cout << e.from << " " << e.to << " " << e.weight << endl;
     }
+    for(auto e: filter_kruskal(g, 4, 2)) {
+        cout << e.from << " " << e.to << " " << e.weight << endl;
+    }
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./kruskal [n] [m] [max threads] [max weight], build with -O3 -pthread
+// a random graph with n vertices and m edges, 1M and 20M by default, weights in [0, max weight), 1e9 by default
+// a path through all vertices is added so that the graph is connected
+// each edge takes 12 bytes, and filter_kruskal needs two more copies of the edges, 100M edges need about 4GB
+
+#include <iostream>
+#include <chrono>
+#include <string>
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? stoi(argv[1]) : 1000000;
+    long long m = argc > 2 ? stoll(argv[2]) : 20000000;
+    int max_threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    int max_weight = argc > 4 ? stoi(argv[4]) : 1000000000;
+    mt19937 rng(0);
+    vector<Edge> g;
+    g.reserve(m + n);
+    for(int i = 0; i + 1 < n; ++i) g.push_back(Edge(i, i + 1, rng() % max_weight));
+    for(long long i = 0; i < m; ++i) g.push_back(Edge(rng() % n, rng() % n, rng() % max_weight));
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    auto weight = [](const vector<Edge>& mst) {
+        long long sum = 0;
+        for(auto& e : mst) sum += e.weight;
+        return sum;
+    };
+
+    auto t0 = chrono::high_resolution_clock::now();
+    long long expected = weight(kruskal(g, n));
+    auto t1 = chrono::high_resolution_clock::now();
+    cout << n << " vertices, " << g.size() << " edges: kruskal " << ms(t0, t1) << "ms" << endl;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        auto t2 = chrono::high_resolution_clock::now();
+        long long got = weight(filter_kruskal(g, n, threads));
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << "filter kruskal, " << threads << " threads: " << ms(t2, t3) << "ms" << (got == expected ? "" : ", WRONG") << endl;
+    }
+    return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
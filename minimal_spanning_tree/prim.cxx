@@ -1,5 +1,12 @@
 #include <vector>
 #include <queue>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include "../graph/csr_graph.hxx"
+#include "../graph/indexed_heap.hxx"
+#include "../misc/barrier.hxx"
 
 using namespace std;
 
@@ -15,7 +22,7 @@ struct Node {
 };
 
 // g is represented by an adjacency list
-vector<Node> prim(vector<vector<Node>> g) {
+vector<Node> prim(const vector<vector<Node>>& g) {
     int n = g.size();
     vector<Node> mst;
     vector<char> vis(n, false);
@@ -46,6 +53,153 @@ vector<Node> prim(vector<vector<Node>> g) {
     return mst;
 }
 
+// the same as above, on a CsrGraph
+vector<Node> prim(const CsrGraph& g) {
+    int n = g.size();
+    vector<Node> mst;
+    vector<char> vis(n, false);
+    priority_queue<Node> pq;
+    pq.push(Node(0, 0));
+    while(!pq.empty()) {
+        Node t = pq.top();
+        pq.pop();
+        if(vis[t.n]) continue;
+        vis[t.n] = true;
+        mst.push_back(t);
+        for(int e = g.offset[t.n]; e < g.offset[t.n + 1]; ++e) {
+            if(!vis[g.to[e]]) {
+                pq.push(Node(g.to[e], g.weight[e]));
+            }
+        }
+    }
+    return mst;
+}
+
+// prim with an IndexedHeap, g must hold every undirected edge in both directions
+// the key of a vertex is the weight of the lightest edge from the tree to it, and parent is the tree end of that edge
+// returns the mst as Edge(parent, child, weight), in the order the vertices join the tree
+// on a disconnected graph, every component is started again from its smallest vertex, so it is a spanning forest
+template<int D = 4>
+vector<Edge> indexed_prim(const CsrGraph& g) {
+    int n = g.size();
+    vector<Edge> mst;
+    vector<int> parent(n, -1);
+    vector<char> vis(n, false);
+    IndexedHeap<D> heap(n);
+    for(int root = 0; root < n; ++root) {
+        if(vis[root]) continue;
+        heap.push(root, 0);
+        while(!heap.empty()) {
+            int u = heap.pop();
+            vis[u] = true;
+            if(parent[u] != -1) mst.push_back(Edge(parent[u], u, heap.key[u]));
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+                int v = g.to[e];
+                if(!vis[v] && heap.push(v, g.weight[e])) parent[v] = u;
+            }
+        }
+    }
+    return mst;
+}
+
+// parallel boruvka, on the same graph as indexed_prim, every undirected edge in both directions
+// every round, each component picks the lightest edge leaving it, all those edges are in the mst, and the components they join are merged
+// the count of components at least halves every round, so there are at most log n rounds
+// picking the edges scans all vertices and is split across the threads, each component keeps its lightest edge in an atomic,
+// lowered with compare and swap, the merging only touches one edge per component and is done serially
+// edges of equal weight are ordered by their ends, so that the picked edges can never close a cycle
+// returns a spanning forest as Edge(from, to, weight), in no particular order
+vector<Edge> boruvka(const CsrGraph& g, int threads) {
+    int n = g.size();
+    vector<Edge> mst;
+    // comp[v] is the representative of the component of v, fa is a disjoint set over the representatives
+    vector<int> comp(n), fa(n), size(n, 1);
+    for(int v = 0; v < n; ++v) comp[v] = fa[v] = v;
+    auto find = [&](int x) {
+        while(fa[x] != x) {
+            fa[x] = fa[fa[x]];
+            x = fa[x];
+        }
+        return x;
+    };
+    // a copy of the edges, those of u are at offset[u]..last[u], the ones inside a component are dropped on the way
+    // so that every edge is scanned only until its ends are merged, not in every round
+    vector<int> to(g.to), weight(g.weight), last(g.offset.begin() + 1, g.offset.end());
+    // whether edge e from u is lighter than edge f from w
+    auto lighter = [&](int e, int u, int f, int w) {
+        if(weight[e] != weight[f]) return weight[e] < weight[f];
+        return make_pair(min(u, to[e]), max(u, to[e])) < make_pair(min(w, to[f]), max(w, to[f]));
+    };
+    // the threads are started once and reused by every round, small graphs get fewer of them
+    constexpr int MIN_PER_THREAD = 4096;
+    WorkerPool pool(max(1, min(threads, n / MIN_PER_THREAD)));
+    auto parallel_for = [&](auto f) {
+        int count = pool.size();
+        pool.run([&](int t) { f((long long)n * t / count, (long long)n * (t + 1) / count); });
+    };
+
+    // pick[u] is the lightest edge leaving the component from u
+    // best[c] is the vertex of c whose pick is the lightest, -1 for none, the vertex rather than the edge, so that both ends are known
+    vector<int> pick(n);
+    vector<atomic<int>> best(n);
+    for(auto& b : best) b.store(-1, memory_order_relaxed);
+    vector<int> roots(n), label(n);
+    for(int v = 0; v < n; ++v) roots[v] = v;
+    while(true) {
+        parallel_for([&](int begin, int end) {
+            for(int u = begin; u < end; ++u) {
+                int cu = comp[u];
+                // the lightest edge of u first, so that there is at most one compare and swap per vertex
+                // an edge inside the component stays there, so it is swapped to the dropped end of the list of u
+                int mine = -1;
+                for(int e = g.offset[u]; e < last[u]; ) {
+                    if(comp[to[e]] == cu) {
+                        --last[u];
+                        swap(to[e], to[last[u]]);
+                        swap(weight[e], weight[last[u]]);
+                        continue;
+                    }
+                    if(mine == -1 || lighter(e, u, mine, u)) mine = e;
+                    ++e;
+                }
+                if(mine == -1) continue;
+                pick[u] = mine;
+                // release, so that whoever reads u from best also sees pick[u]
+                int cur = best[cu].load(memory_order_acquire);
+                while((cur == -1 || lighter(mine, u, pick[cur], cur)) && !best[cu].compare_exchange_weak(cur, u, memory_order_acq_rel, memory_order_acquire));
+            }
+        });
+
+        bool merged = false;
+        for(int c : roots) {
+            int u = best[c].load(memory_order_relaxed);
+            if(u == -1) continue;
+            best[c].store(-1, memory_order_relaxed);
+            int e = pick[u], v = to[e];
+            int x = find(comp[u]), y = find(comp[v]);
+            // both components may have picked the same edge
+            if(x == y) continue;
+            if(size[x] > size[y]) swap(x, y);
+            fa[x] = y;
+            size[y] += size[x];
+            mst.push_back(Edge(u, v, weight[e]));
+            merged = true;
+        }
+        if(!merged) break;
+        // the new representative of every old one, so that relabelling the vertices needs no find
+        vector<int> next;
+        for(int c : roots) {
+            label[c] = find(c);
+            if(label[c] == c) next.push_back(c);
+        }
+        roots.swap(next);
+        parallel_for([&](int begin, int end) {
+            for(int v = begin; v < end; ++v) comp[v] = label[comp[v]];
+        });
+    }
+    return mst;
+}
+
 #ifdef DEBUG
 
 #include <iostream>
@@ -69,7 +223,65 @@ int main() {
     for(auto n: mst) {
         cout << n.n << " " << n.weight << endl;
     }
+
+    for(auto n: prim(CsrGraph(g))) {
+        cout << n.n << " " << n.weight << " ";
+    }
+    cout << endl;
+
+    for(auto e: indexed_prim(CsrGraph(g))) {
+        cout << e.from << " -> " << e.to << " " << e.weight << endl;
+    }
+    for(auto e: boruvka(CsrGraph(g), 2)) {
+        cout << e.from << " - " << e.to << " " << e.weight << endl;
+    }
+    return 0;
+}
+
+#endif
+#ifdef BENCHMARK
+
+// usage: ./prim [n] [m] [max threads], build with -O3 -pthread
+// a random sparse graph with n vertices and m undirected edges, 1M and 5M by default, plus a path through all vertices to connect it
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? stoi(argv[1]) : 1000000;
+    int m = argc > 2 ? stoi(argv[2]) : 5000000;
+    int max_threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    mt19937 rng(0);
+    vector<Edge> es;
+    es.reserve(2 * (m + n));
+    auto add = [&](int u, int v, int w) {
+        es.push_back(Edge(u, v, w));
+        es.push_back(Edge(v, u, w));
+    };
+    for(int i = 0; i + 1 < n; ++i) add(i, i + 1, rng() % 1000000);
+    for(int i = 0; i < m; ++i) add(rng() % n, rng() % n, rng() % 1000000);
+    CsrGraph g(n, es);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+
+    auto t0 = chrono::high_resolution_clock::now();
+    long long expected = 0;
+    for(auto& t : prim(g)) expected += t.weight;
+    auto t1 = chrono::high_resolution_clock::now();
+    long long got = 0;
+    for(auto& e : indexed_prim(g)) got += e.weight;
+    auto t2 = chrono::high_resolution_clock::now();
+    cout << n << " vertices, " << es.size() / 2 << " edges: prim " << ms(t0, t1) << "ms"
+         << ", indexed 4-ary heap " << ms(t1, t2) << "ms" << (got == expected ? "" : ", WRONG") << endl;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        auto t3 = chrono::high_resolution_clock::now();
+        long long sum = 0;
+        for(auto& e : boruvka(g, threads)) sum += e.weight;
+        auto t4 = chrono::high_resolution_clock::now();
+        cout << "boruvka, " << threads << " threads: " << ms(t3, t4) << "ms" << (sum == expected ? "" : ", WRONG") << endl;
+    }
     return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
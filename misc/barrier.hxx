@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// a reusable barrier for a fixed number of threads, std::barrier is c++20
+// so that a parallel algorithm keeps one set of workers for all of its rounds
+// instead of creating and joining threads every round
+// wait blocks until all count threads have called it, then releases them all at once
+// everything a thread wrote before wait is visible to every thread after it
+struct Barrier {
+    mutex lock;
+    condition_variable cv;
+    int count;
+    int waiting;
+    // counts the finished rounds, so that a thread already in the next round can't release this one
+    unsigned generation;
+
+    Barrier(int count) : count(count), waiting(0), generation(0) {}
+
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        unsigned current = generation;
+        if(++waiting == count) {
+            waiting = 0;
+            ++generation;
+            cv.notify_all();
+            return;
+        }
+        cv.wait(guard, [&] { return generation != current; });
+    }
+};
+
+// threads - 1 workers that are started once and then run one job after another, the calling thread is worker 0
+// run(f) calls f(t) for every t in 0..threads and returns when all of them are done
+// between two runs the workers sleep at the barrier
+struct WorkerPool {
+    Barrier barrier;
+    function<void(int)> job;
+    bool stop;
+    vector<thread> workers;
+
+    WorkerPool(int threads) : barrier(threads), stop(false) {
+        for(int t = 1; t < threads; ++t) {
+            workers.emplace_back([this, t] {
+                while(true) {
+                    barrier.wait();
+                    if(stop) return;
+                    job(t);
+                    barrier.wait();
+                }
+            });
+        }
+    }
+
+    ~WorkerPool() {
+        stop = true;
+        barrier.wait();
+        for(auto& th : workers) th.join();
+    }
+
+    int size() const {
+        return workers.size() + 1;
+    }
+
+    void run(function<void(int)> f) {
+        job = move(f);
+        barrier.wait();
+        job(0);
+        barrier.wait();
+    }
+};
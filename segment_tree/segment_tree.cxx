@@ -1,5 +1,7 @@
 #include <vector>
 #include <functional>
+#include <algorithm>
+#include <climits>
 
 using namespace std;
 
@@ -9,8 +11,15 @@ struct Node {
     int val;
     int l;
     int r;
+    // lazy tags, only used by range_add and range_assign
+    // add is the pending delta for every element of the children
+    // assign is the pending value for every element of the children, valid when has_assign is set
+    // a pending assign always comes before a pending add
+    int add;
+    int assign;
+    bool has_assign;
     Node(int val, int l, int r, Node* left = nullptr, Node* right = nullptr) :
-        val(val), l(l), r(r), left(left), right(right) {}
+        val(val), l(l), r(r), left(left), right(right), add(0), assign(0), has_assign(false) {}
 };
 
 struct SegmentTree
@@ -36,6 +45,7 @@ struct SegmentTree
             if(node == nullptr) return 0;
             if(node->l > r || node->r < l) return 0;
             if(node->l >= l && node->r <= r) return node->val;
+            push_down(node);
             return f(node->left, l, r) + f(node->right, l, r);
         };
         return f(root, l, r);
@@ -46,6 +56,7 @@ struct SegmentTree
                 node->val = val;
                 return;
             }
+            push_down(node);
             int mid = (node->l + node->r) / 2;
             if(idx <= mid) {
                 f(node->left, idx, val);
@@ -56,6 +67,304 @@ struct SegmentTree
         };
         f(root, idx, val);
     }
+
+    // add delta to every element of l..=r, O(log n) regardless of the width
+    void range_add(int l, int r, int delta) {
+        function<void(Node*)> f = [&](Node* node) {
+            if(node->l > r || node->r < l) return;
+            // the whole node is covered, tag it and stop here
+            if(node->l >= l && node->r <= r) {
+                apply_add(node, delta);
+                return;
+            }
+            push_down(node);
+            f(node->left);
+            f(node->right);
+            node->val = node->left->val + node->right->val;
+        };
+        f(root);
+    }
+
+    // set every element of l..=r to val, O(log n) regardless of the width
+    void range_assign(int l, int r, int val) {
+        function<void(Node*)> f = [&](Node* node) {
+            if(node->l > r || node->r < l) return;
+            if(node->l >= l && node->r <= r) {
+                apply_assign(node, val);
+                return;
+            }
+            push_down(node);
+            f(node->left);
+            f(node->right);
+            node->val = node->left->val + node->right->val;
+        };
+        f(root);
+    }
+
+    // node->val is always up to date, the tags only describe what the children still miss
+    static void apply_add(Node* node, int delta) {
+        node->val += delta * (node->r - node->l + 1);
+        // an add after an assign can be folded into the assign
+        if(node->has_assign) node->assign += delta;
+        else node->add += delta;
+    }
+
+    static void apply_assign(Node* node, int val) {
+        node->val = val * (node->r - node->l + 1);
+        // an assign overrides everything pending below it
+        node->assign = val;
+        node->has_assign = true;
+        node->add = 0;
+    }
+
+    // hand the tags of node to its children, only called right before visiting them
+    static void push_down(Node* node) {
+        if(node->left == nullptr) return;
+        if(node->has_assign) {
+            apply_assign(node->left, node->assign);
+            apply_assign(node->right, node->assign);
+            node->has_assign = false;
+        }
+        if(node->add != 0) {
+            apply_add(node->left, node->add);
+            apply_add(node->right, node->add);
+            node->add = 0;
+        }
+    }
+};
+
+// PoolNode is the node of PooledSegmentTree
+// children are indices into the pool instead of pointers, -1 for no child
+// the range of a node is not stored, it is passed down while walking the tree
+struct PoolNode {
+    int left;
+    int right;
+    int val;
+    PoolNode(int val, int left = -1, int right = -1) : left(left), right(right), val(val) {}
+};
+
+// same as SegmentTree, but all nodes live in one contiguous vector
+// so build costs a single allocation, and the whole tree is freed with the vector
+struct PooledSegmentTree
+{
+    vector<PoolNode> pool;
+    int root;
+    int n;
+
+    PooledSegmentTree() : root(-1), n(0) {}
+
+    PooledSegmentTree(const vector<int>& raw) : root(-1), n(0) {
+        build(raw);
+    }
+
+    // a tree with n leaves has exactly 2 * n - 1 nodes
+    void reserve(int n) {
+        if(n > 0) pool.reserve(2 * n - 1);
+    }
+
+    // drop all nodes but keep the capacity, so the next build doesn't allocate
+    void clear() {
+        pool.clear();
+        root = -1;
+        n = 0;
+    }
+
+    void build(const vector<int>& raw) {
+        clear();
+        n = raw.size();
+        if(n == 0) return;
+        reserve(n);
+        root = build(raw, 0, n - 1);
+    }
+
+    int query(int l, int r) const {
+        if(root == -1) return 0;
+        return query(root, 0, n - 1, l, r);
+    }
+
+    void update(int idx, int val) {
+        if(root == -1) return;
+        update(root, 0, n - 1, idx, val);
+    }
+
+private:
+    // the parent is allocated before its children
+    // so the left child always sits right after its parent in the pool
+    int build(const vector<int>& raw, int l, int r) {
+        int node = pool.size();
+        pool.push_back(PoolNode(raw[l]));
+        if(l == r) return node;
+        int mid = (l + r) / 2;
+        int left = build(raw, l, mid);
+        int right = build(raw, mid + 1, r);
+        // pool may have been reallocated, so index it again instead of keeping a reference
+        pool[node] = PoolNode(pool[left].val + pool[right].val, left, right);
+        return node;
+    }
+
+    int query(int node, int nl, int nr, int l, int r) const {
+        if(nl > r || nr < l) return 0;
+        if(nl >= l && nr <= r) return pool[node].val;
+        int mid = (nl + nr) / 2;
+        return query(pool[node].left, nl, mid, l, r) + query(pool[node].right, mid + 1, nr, l, r);
+    }
+
+    void update(int node, int nl, int nr, int idx, int val) {
+        if(nl == nr) {
+            pool[node].val = val;
+            return;
+        }
+        int mid = (nl + nr) / 2;
+        if(idx <= mid) {
+            update(pool[node].left, nl, mid, idx, val);
+        } else {
+            update(pool[node].right, mid + 1, nr, idx, val);
+        }
+        pool[node].val = pool[pool[node].left].val + pool[pool[node].right].val;
+    }
+};
+
+// a persistent segment tree, every update makes a new version and keeps all old ones
+// an update copies only the log n nodes on the path to the leaf, the rest is shared with the old version
+// so every version costs O(log n) nodes, and all of them live in one pool like PooledSegmentTree
+struct PersistentSegmentTree
+{
+    vector<PoolNode> pool;
+    // roots[v] is the root of version v, version 0 is the tree built from raw
+    // like PooledSegmentTree, a tree of no elements has no nodes and its roots are -1
+    vector<int> roots;
+    int n;
+
+    PersistentSegmentTree(const vector<int>& raw) : n(raw.size()) {
+        pool.reserve(2 * n);
+        roots.push_back(n == 0 ? -1 : build(raw, 0, n - 1));
+    }
+
+    // make room for the given number of extra versions, so that pushing them doesn't reallocate
+    void reserve(int versions) {
+        roots.reserve(roots.size() + versions);
+        if(n == 0) return;
+        int depth = 1;
+        for(int size = 1; size < n; size *= 2) ++depth;
+        pool.reserve(pool.size() + (size_t)versions * depth);
+    }
+
+    int versions() const {
+        return roots.size();
+    }
+
+    // set the idx-th element of the given version to val, returns the new version
+    // on a tree of no elements there is nothing to set, the new version is the same empty tree
+    int update(int version, int idx, int val) {
+        roots.push_back(n == 0 ? -1 : modify(roots[version], 0, n - 1, idx, val, false));
+        return roots.size() - 1;
+    }
+
+    // add delta to the idx-th element of the given version, returns the new version
+    int add(int version, int idx, int delta) {
+        roots.push_back(n == 0 ? -1 : modify(roots[version], 0, n - 1, idx, delta, true));
+        return roots.size() - 1;
+    }
+
+    // the sum of l..=r as of the given version
+    int query(int version, int l, int r) const {
+        if(n == 0) return 0;
+        return query(roots[version], 0, n - 1, l, r);
+    }
+
+    // treat newer - older as an array of counts, find the smallest idx
+    // such that the counts of 0..=idx sum up to at least k, k starts from 1
+    // both versions are walked together, so it is O(log n)
+    // -1 if k is less than 1 or more than all the counts together
+    int kth(int older, int newer, int k) const {
+        if(n == 0) return -1;
+        int a = roots[older], b = roots[newer];
+        if(k < 1 || k > pool[b].val - pool[a].val) return -1;
+        int l = 0, r = n - 1;
+        while(l < r) {
+            int mid = (l + r) / 2;
+            int count = pool[pool[b].left].val - pool[pool[a].left].val;
+            if(k <= count) {
+                a = pool[a].left;
+                b = pool[b].left;
+                r = mid;
+            } else {
+                k -= count;
+                a = pool[a].right;
+                b = pool[b].right;
+                l = mid + 1;
+            }
+        }
+        return l;
+    }
+
+private:
+    int build(const vector<int>& raw, int l, int r) {
+        int node = pool.size();
+        pool.push_back(PoolNode(raw[l]));
+        if(l == r) return node;
+        int mid = (l + r) / 2;
+        int left = build(raw, l, mid);
+        int right = build(raw, mid + 1, r);
+        pool[node] = PoolNode(pool[left].val + pool[right].val, left, right);
+        return node;
+    }
+
+    // copy the path from node down to the leaf idx, the untouched children are shared
+    int modify(int node, int nl, int nr, int idx, int val, bool relative) {
+        if(nl == nr) {
+            pool.push_back(PoolNode(relative ? pool[node].val + val : val));
+            return pool.size() - 1;
+        }
+        int mid = (nl + nr) / 2;
+        int left = pool[node].left;
+        int right = pool[node].right;
+        if(idx <= mid) {
+            left = modify(left, nl, mid, idx, val, relative);
+        } else {
+            right = modify(right, mid + 1, nr, idx, val, relative);
+        }
+        pool.push_back(PoolNode(pool[left].val + pool[right].val, left, right));
+        return pool.size() - 1;
+    }
+
+    int query(int node, int nl, int nr, int l, int r) const {
+        if(nl > r || nr < l) return 0;
+        if(nl >= l && nr <= r) return pool[node].val;
+        int mid = (nl + nr) / 2;
+        return query(pool[node].left, nl, mid, l, r) + query(pool[node].right, mid + 1, nr, l, r);
+    }
+};
+
+// the k-th smallest element of raw[l..=r], built on PersistentSegmentTree
+// version i + 1 counts how many of raw[0..i] fall on each value
+// so version r + 1 minus version l counts exactly raw[l..=r]
+struct RangeKthSmallest
+{
+    vector<int> sorted;
+    PersistentSegmentTree counts;
+
+    RangeKthSmallest(const vector<int>& raw) : sorted(compress(raw)), counts(vector<int>(sorted.size(), 0)) {
+        counts.reserve(raw.size());
+        for(int i = 0; i < (int)raw.size(); ++i) {
+            int rank = lower_bound(sorted.begin(), sorted.end(), raw[i]) - sorted.begin();
+            counts.add(i, rank, 1);
+        }
+    }
+
+    // k starts from 1, l r all starts from 0
+    // INT_MIN if there is no k-th element, that is, k is not within 1..=r - l + 1
+    int query(int l, int r, int k) const {
+        int rank = counts.kth(l, r + 1, k);
+        return rank == -1 ? INT_MIN : sorted[rank];
+    }
+
+private:
+    static vector<int> compress(vector<int> raw) {
+        sort(raw.begin(), raw.end());
+        raw.erase(unique(raw.begin(), raw.end()), raw.end());
+        return raw;
+    }
 };
 
 #ifdef DEBUG
@@ -77,6 +386,169 @@ int main() {
     st.update(1, 10);
     print(st.root, 0);
     cout << st.query(0, 2) << endl;
+
+    st.range_add(0, 4, 1);
+    cout << st.query(0, 2) << endl;
+    st.range_assign(1, 3, 2);
+    cout << st.query(0, 4) << endl;
+
+    PooledSegmentTree pst(raw);
+    cout << pst.query(0, 2) << endl;
+    pst.update(1, 10);
+    cout << pst.query(0, 2) << endl;
+
+    PersistentSegmentTree vst(raw);
+    int v1 = vst.update(0, 1, 10);
+    int v2 = vst.add(v1, 0, 5);
+    cout << vst.query(0, 0, 2) << " " << vst.query(v1, 0, 2) << " " << vst.query(v2, 0, 2) << endl;
+
+    RangeKthSmallest kth({5, 1, 4, 2, 3});
+    cout << kth.query(0, 4, 1) << " " << kth.query(0, 2, 2) << " " << kth.query(1, 3, 3) << endl;
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./segment_tree [pointer|pooled|range|persistent] [n]
+// peak rss is per process, so run each version in a separate process to compare it
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+
+template<typename Tree>
+void run(const string& name, const vector<int>& raw, int rounds) {
+    int n = raw.size();
+    mt19937 rng(42);
+    vector<int> ls(rounds), rs(rounds);
+    for(int i = 0; i < rounds; ++i) {
+        ls[i] = rng() % n;
+        rs[i] = ls[i] + rng() % (n - ls[i]);
+    }
+
+    auto t0 = chrono::high_resolution_clock::now();
+    Tree st(raw);
+    auto t1 = chrono::high_resolution_clock::now();
+    long long sum = 0;
+    for(int i = 0; i < rounds; ++i) sum += st.query(ls[i], rs[i]);
+    auto t2 = chrono::high_resolution_clock::now();
+    for(int i = 0; i < rounds; ++i) st.update(ls[i], rs[i]);
+    auto t3 = chrono::high_resolution_clock::now();
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    cout << name << ": build " << ms(t0, t1) << "ms"
+         << ", query " << ms(t1, t2) * 1e6 / rounds << "ns"
+         << ", update " << ms(t2, t3) * 1e6 / rounds << "ns"
+         << ", peak rss " << usage.ru_maxrss / 1024 << "MB"
+         << " (checksum " << sum << ")" << endl;
+}
+
+// mixed range updates and range queries, lazy tags against one point update per element
+void run_range(const vector<int>& raw, int rounds, int width) {
+    int n = raw.size();
+    mt19937 rng(7);
+    vector<int> ls(rounds);
+    for(int i = 0; i < rounds; ++i) ls[i] = rng() % (n - width + 1);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+
+    SegmentTree lazy(raw);
+    auto t0 = chrono::high_resolution_clock::now();
+    long long lazy_sum = 0;
+    for(int i = 0; i < rounds; ++i) {
+        int l = ls[i], r = ls[i] + width - 1;
+        if(i % 2 == 0) lazy.range_add(l, r, 1);
+        else lazy.range_assign(l, r, i % 7);
+        lazy_sum += lazy.query(l, r);
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+
+    SegmentTree point(raw);
+    vector<int> cur = raw;
+    auto t2 = chrono::high_resolution_clock::now();
+    long long point_sum = 0;
+    for(int i = 0; i < rounds; ++i) {
+        int l = ls[i], r = ls[i] + width - 1;
+        for(int j = l; j <= r; ++j) {
+            cur[j] = i % 2 == 0 ? cur[j] + 1 : i % 7;
+            point.update(j, cur[j]);
+        }
+        point_sum += point.query(l, r);
+    }
+    auto t3 = chrono::high_resolution_clock::now();
+
+    cout << "range width " << width << ": lazy " << ms(t0, t1) * 1e3 / rounds << "us"
+         << ", point loop " << ms(t2, t3) * 1e3 / rounds << "us"
+         << " per update + query (checksums " << lazy_sum << " " << point_sum << ")" << endl;
+}
+
+// many versions of point updates, then sums as of random versions and range k-th smallest
+void run_persistent(const vector<int>& raw, int versions, int rounds) {
+    int n = raw.size();
+    mt19937 rng(3);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+
+    auto t0 = chrono::high_resolution_clock::now();
+    PersistentSegmentTree st(raw);
+    st.reserve(versions);
+    for(int v = 0; v < versions; ++v) st.update(v, rng() % n, rng() % 100);
+    auto t1 = chrono::high_resolution_clock::now();
+    long long sum = 0;
+    for(int i = 0; i < rounds; ++i) {
+        int l = rng() % n;
+        int r = l + rng() % (n - l);
+        sum += st.query(rng() % st.versions(), l, r);
+    }
+    auto t2 = chrono::high_resolution_clock::now();
+    RangeKthSmallest kth(raw);
+    auto t3 = chrono::high_resolution_clock::now();
+    for(int i = 0; i < rounds; ++i) {
+        int l = rng() % n;
+        int r = l + rng() % (n - l);
+        sum += kth.query(l, r, 1 + rng() % (r - l + 1));
+    }
+    auto t4 = chrono::high_resolution_clock::now();
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "persistent: " << versions << " versions in " << ms(t0, t1) << "ms"
+         << " (" << st.pool.size() * sizeof(PoolNode) / (1 << 20) << "MB of nodes"
+         << ", snapshots would take " << (long long)versions * n * sizeof(int) / (1 << 20) << "MB)"
+         << ", query as of version " << ms(t1, t2) * 1e6 / rounds << "ns"
+         << ", kth build " << ms(t2, t3) << "ms"
+         << ", kth query " << ms(t3, t4) * 1e6 / rounds << "ns"
+         << ", peak rss " << usage.ru_maxrss / 1024 << "MB"
+         << " (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "pooled";
+    if(mode == "persistent") {
+        int n = argc > 2 ? stoi(argv[2]) : 1000000;
+        vector<int> raw(n);
+        mt19937 rng(0);
+        for(int i = 0; i < n; ++i) raw[i] = rng() % 1000000;
+        run_persistent(raw, 1000000, 1000000);
+        return 0;
+    }
+    if(mode == "range") {
+        int n = argc > 2 ? stoi(argv[2]) : 1000000;
+        vector<int> raw(n, 1);
+        run_range(raw, 1000, min(n, 100000));
+        return 0;
+    }
+    int n = argc > 2 ? stoi(argv[2]) : 10000000;
+    constexpr int ROUNDS = 1000000;
+    vector<int> raw(n);
+    mt19937 rng(0);
+    for(int i = 0; i < n; ++i) raw[i] = rng() % 100;
+    if(mode == "pointer") run<SegmentTree>("pointer", raw, ROUNDS);
+    else run<PooledSegmentTree>("pooled", raw, ROUNDS);
     return 0;
 }
 
@@ -1,34 +1,82 @@
 #include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
+// a monoid is a type with an identity and an associative combine
+// the tree calls them statically, so the operator is inlined into the loops
+template <typename T>
+struct SumMonoid
+{
+    static T identity() { return T(0); }
+    static T combine(const T &a, const T &b) { return a + b; }
+};
+
+template <typename T>
+struct MinMonoid
+{
+    static T identity() { return numeric_limits<T>::max(); }
+    static T combine(const T &a, const T &b) { return min(a, b); }
+};
+
+template <typename T>
+struct MaxMonoid
+{
+    static T identity() { return numeric_limits<T>::lowest(); }
+    static T combine(const T &a, const T &b) { return max(a, b); }
+};
+
+template <typename T>
+struct GcdMonoid
+{
+    static T identity() { return T(0); }
+    static T combine(const T &a, const T &b) { return gcd(a, b); }
+};
+
+template <typename T>
+struct XorMonoid
+{
+    static T identity() { return T(0); }
+    static T combine(const T &a, const T &b) { return a ^ b; }
+};
+
+template <typename T, typename Monoid = SumMonoid<T>>
 struct SegmentTree
 {
-    vector<int> val;
+    vector<T> val;
     int n;
 
-    SegmentTree(const vector<int> &raw)
+    SegmentTree(const vector<T> &raw)
     {
         n = raw.size();
 
         // val starts from 1 so as to prevent -1 to appear in the query function
-        // the count of total nodes is 2 * n - 1
-        // so we allocate 2 * n + 1 space, + 1 for the 0th element that isn't used
-        // however, this is the case when n is a power of 2, so we allocate 4 * n space, just in case
-        val = vector<int>(4 * n, 0);
+        // the count of total nodes is 2 * n - 1, + 1 for the 0th element that isn't used
+        // this holds for any n, not only powers of 2
+        // when n isn't a power of 2, some internal nodes cover leaves that wrap around layers
+        // but query never uses them as a whole, so 2 * n is enough
+        val = vector<T>(2 * n, Monoid::identity());
 
         // init the leaf nodes
         for (int i = 0; i < n; ++i) val[i + n] = raw[i];
 
         // calculate the internal nodes
         // because the upper nodes has lower index, we calculate from the bottom to the top
-        for (int i = n - 1; i > 0; --i) val[i] = val[2 * i] + val[2 * i + 1];
+        for (int i = n - 1; i > 0; --i) val[i] = Monoid::combine(val[2 * i], val[2 * i + 1]);
     }
 
-    // query the sum of l..=r, l r all starts from 0
-    int query(int l, int r)
+    // query the combination of l..=r, l r all starts from 0
+    T query(int l, int r) const
     {
-        int ret = 0;
+        // the nodes on the left side and those on the right side are kept apart
+        // so that the order of combine is preserved, in case the monoid isn't commutative
+        T left = Monoid::identity();
+        T right = Monoid::identity();
 
         // l += n so that it is located to the leaf node, same for r
         // when l > r, all calculations are done
@@ -56,7 +104,7 @@ struct SegmentTree
             // after l /= 2, it moves to the upper layer
             if (l % 2 == 1)
             {
-                ret += val[l];
+                left = Monoid::combine(left, val[l]);
                 ++l;
             }
 
@@ -66,26 +114,228 @@ struct SegmentTree
             // so the value is added, then r moves to the left
             if (r % 2 == 0)
             {
-                ret += val[r];
+                right = Monoid::combine(val[r], right);
                 --r;
             }
         }
-        return ret;
+        return Monoid::combine(left, right);
     }
 
     // update the value of the i-th element to v, i starts from 0
-    void update(int i, int v)
+    void update(int i, T v)
     {
         val[i + n] = v;
         // the affected nodes are the nodes on the path from the leaf to the root
         // that is, all nodes whose index is i or i's ancestor
         // the first should be i + n, but it's modified to v
         // so we start from (i + n) / 2
-        for (i = (i + n) / 2; i > 0; i /= 2) val[i] = val[2 * i] + val[2 * i + 1];
+        for (i = (i + n) / 2; i > 0; i /= 2) val[i] = Monoid::combine(val[2 * i], val[2 * i + 1]);
+    }
+
+    // apply many (i, v) updates at once, same as calling update for each in order
+    // all leaves are written first, then every affected ancestor is recomputed exactly once
+    void update_batch(const vector<pair<int, T>> &updates)
+    {
+        vector<int> nodes;
+        nodes.reserve(updates.size());
+        for (const auto &[i, v] : updates)
+        {
+            val[i + n] = v;
+            nodes.push_back((i + n) / 2);
+        }
+        sort(nodes.begin(), nodes.end(), greater<int>());
+        nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+
+        // a parent always has a lower index than its children
+        // so visiting the nodes from the largest index down recomputes every child before its parent
+        // the parents are produced in non-increasing order too, so they form a second sorted queue
+        // and merging the two queues gives the next node to recompute, each one exactly once
+        // for a power of 2 n this walks the tree level by level
+        vector<int> parents;
+        parents.reserve(nodes.size());
+        size_t a = 0, b = 0;
+        int last = 0;
+        while (a < nodes.size() || b < parents.size())
+        {
+            int i;
+            if (b == parents.size() || (a < nodes.size() && nodes[a] >= parents[b])) i = nodes[a++];
+            else i = parents[b++];
+            if (i == last) continue;
+            last = i;
+            val[i] = Monoid::combine(val[2 * i], val[2 * i + 1]);
+            if (i > 1) parents.push_back(i / 2);
+        }
+    }
+};
+
+// the same tree for one writer thread and any number of reader threads, readers never take a lock
+// the nodes are atomics, and a sequence counter guards the update as a seqlock
+// the counter is odd while an update is running, and grows by 2 with every finished update
+// a query reads the counter before and after its walk, and retries when it changed or was odd
+// so every query sees the tree exactly as it was between two updates, that is, it is linearizable
+// update stays O(log n) and never waits for readers, but only one thread may call it at a time
+// T has to be trivially copyable, and should be lock-free as an atomic
+template <typename T, typename Monoid = SumMonoid<T>>
+struct ConcurrentSegmentTree
+{
+    vector<atomic<T>> val;
+    // keep the counter on its own cache line, so the readers spinning on it don't share it with the nodes
+    alignas(64) atomic<unsigned> seq;
+    int n;
+
+    ConcurrentSegmentTree(const vector<T> &raw) : val(2 * raw.size()), seq(0), n(raw.size())
+    {
+        for (int i = 0; i < n; ++i) val[i + n].store(raw[i], memory_order_relaxed);
+        for (int i = n - 1; i > 0; --i) val[i].store(Monoid::combine(load(2 * i), load(2 * i + 1)), memory_order_relaxed);
+        val[0].store(Monoid::identity(), memory_order_relaxed);
+    }
+
+    // query the combination of l..=r, l r all starts from 0, safe to call from any thread
+    T query(int l, int r) const
+    {
+        while (true)
+        {
+            unsigned before = seq.load(memory_order_acquire);
+            // an update is running, the path it writes may be half done
+            // give the writer the core in case it was preempted in the middle
+            if (before % 2 == 1)
+            {
+                this_thread::yield();
+                continue;
+            }
+            T left = Monoid::identity();
+            T right = Monoid::identity();
+            for (int a = l + n, b = r + n; a <= b; a /= 2, b /= 2)
+            {
+                if (a % 2 == 1) left = Monoid::combine(left, load(a++));
+                if (b % 2 == 0) right = Monoid::combine(load(b--), right);
+            }
+            // the loads above must not move after the second read of the counter
+            atomic_thread_fence(memory_order_acquire);
+            if (seq.load(memory_order_relaxed) == before) return Monoid::combine(left, right);
+        }
+    }
+
+    // update the value of the i-th element to v, i starts from 0, only one thread may call it
+    void update(int i, T v)
+    {
+        unsigned before = seq.load(memory_order_relaxed);
+        seq.store(before + 1, memory_order_relaxed);
+        // the stores to the nodes must not move before the counter turns odd
+        atomic_thread_fence(memory_order_release);
+        val[i + n].store(v, memory_order_relaxed);
+        for (i = (i + n) / 2; i > 0; i /= 2) val[i].store(Monoid::combine(load(2 * i), load(2 * i + 1)), memory_order_relaxed);
+        seq.store(before + 2, memory_order_release);
+    }
+
+private:
+    T load(int i) const
+    {
+        return val[i].load(memory_order_relaxed);
+    }
+};
+
+// allocates on a cache line boundary, so that every node of WideSegmentTree is exactly one line
+template <typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+    static constexpr size_t ALIGNMENT = 64;
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(ALIGNMENT))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(ALIGNMENT)); }
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+// a sum segment tree with fanout B instead of 2
+// for int, a node of 16 children is 64 bytes, that is, one cache line
+// so a query touches about log16(n) cache lines instead of log2(n)
+template <typename T, int B = 64 / sizeof(T)>
+struct WideSegmentTree
+{
+    // level k has one entry per unit, a unit of level k covers B ** k consecutive elements
+    // every B consecutive entries form a node, and the entries of a node are exclusive prefix sums
+    // that is, level[k][B * x + j] is the sum of units B * x .. B * x + j - 1 of level k
+    // thus the prefix sum of 0..i is just one entry from each level
+    vector<vector<T, CacheAlignedAllocator<T>>> level;
+    int n;
+
+    WideSegmentTree(const vector<T> &raw)
+    {
+        n = raw.size();
+        vector<T> units(raw);
+        // keep adding levels until a single node can hold all units
+        // prefix may be asked at i == n, so every level needs room for one more unit
+        for (int count = n; ; count = count / B + 1)
+        {
+            int size = (count / B + 1) * B;
+            units.resize(size, T(0));
+            vector<T, CacheAlignedAllocator<T>> cur(size);
+            vector<T> sums(size / B);
+            for (int x = 0; x < size / B; ++x)
+            {
+                const T *u = units.data() + B * x;
+                T *c = cur.data() + B * x;
+                // the sum of the whole node, a horizontal reduction the compiler can vectorize
+                T total = T(0);
+                for (int j = 0; j < B; ++j) total += u[j];
+                sums[x] = total;
+                T acc = T(0);
+                for (int j = 0; j < B; ++j)
+                {
+                    c[j] = acc;
+                    acc += u[j];
+                }
+            }
+            level.push_back(move(cur));
+            if (size == B) break;
+            units = move(sums);
+        }
+    }
+
+    // the sum of 0..i, exclusive, i starts from 0 and is at most n
+    T prefix(int i) const
+    {
+        T ret = T(0);
+        for (size_t k = 0; k < level.size(); ++k, i /= B) ret += level[k][i];
+        return ret;
+    }
+
+    // query the sum of l..=r, l r all starts from 0
+    T query(int l, int r) const
+    {
+        return prefix(r + 1) - prefix(l);
+    }
+
+    // add diff to the i-th element, i starts from 0
+    void add(int i, T diff)
+    {
+        for (size_t k = 0; k < level.size(); ++k, i /= B)
+        {
+            // every entry after i in its node counts the i-th unit
+            // write the whole node without branches, so it becomes a few vector adds
+            T *c = level[k].data() + i / B * B;
+            int pos = i % B;
+            for (int j = 0; j < B; ++j) c[j] += (j > pos) * diff;
+        }
+    }
+
+    // update the value of the i-th element to v, i starts from 0
+    void update(int i, T v)
+    {
+        add(i, v - query(i, i));
     }
 };
 
 #ifdef DEBUG
+
+#include <cstdio>
+
 int main()
 {
     vector<int> raw = {1, 1, 1, 1, 1};
@@ -93,6 +343,195 @@ int main()
     printf("%d\n", st.query(0, 4));
     st.update(1, 10);
     printf("%d\n", st.query(0, 4));
+
+    vector<long long> nums = {12, 18, 6, 9, 24};
+    SegmentTree<long long, MinMonoid<long long>> min_st(nums);
+    SegmentTree<long long, GcdMonoid<long long>> gcd_st(nums);
+    printf("%lld %lld\n", min_st.query(1, 3), gcd_st.query(0, 2));
+
+    st.update_batch({{0, 2}, {3, 5}, {4, 0}});
+    printf("%d %d\n", st.query(0, 4), st.query(2, 3));
+
+    WideSegmentTree<int> wst(raw);
+    printf("%d\n", wst.query(0, 4));
+    wst.update(1, 10);
+    printf("%d\n", wst.query(0, 4));
+
+    ConcurrentSegmentTree<int> cst(raw);
+    printf("%d\n", cst.query(0, 4));
+    cst.update(1, 10);
+    printf("%d\n", cst.query(0, 4));
     return 0;
 }
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./zkw_segment_tree [n ...]
+//        ./zkw_segment_tree concurrent [n] [max readers], build with -pthread for this one
+// the default sizes are 1M, 16M and 256M, the last one needs about 4GB of memory
+// the concurrent mode runs one writer against 1, 2, 4 .. 64 readers by default
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <mutex>
+
+// the values are in 0..MAX_VALUE - 1, small enough that the sum of 256M of them still fits in int
+// so that the int trees, and the 16-ary node of one cache line, are measured without overflow
+constexpr int MAX_VALUE = 8;
+
+template <typename Tree>
+void run(const string &name, const vector<int> &raw, const vector<int> &ls, const vector<int> &rs)
+{
+    int rounds = ls.size();
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    auto t0 = chrono::high_resolution_clock::now();
+    Tree st(raw);
+    auto t1 = chrono::high_resolution_clock::now();
+    long long sum = 0;
+    for (int i = 0; i < rounds; ++i) sum += st.query(ls[i], rs[i]);
+    auto t2 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < rounds; ++i) st.update(ls[i], i % MAX_VALUE);
+    auto t3 = chrono::high_resolution_clock::now();
+    cout << "  " << name << ": build " << ms(t0, t1) << "ms"
+         << ", query " << ms(t1, t2) * 1e6 / rounds << "ns"
+         << ", update " << ms(t2, t3) * 1e6 / rounds << "ns"
+         << " (checksum " << sum << ")" << endl;
+}
+
+// thousands of point updates per tick, one by one against update_batch
+void run_batch(const vector<int> &raw, const vector<int> &ls)
+{
+    constexpr int BATCH = 4096;
+    int rounds = ls.size() / BATCH * BATCH;
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+
+    SegmentTree<int> single(raw);
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < rounds; ++i) single.update(ls[i], i % MAX_VALUE);
+    auto t1 = chrono::high_resolution_clock::now();
+
+    SegmentTree<int> batched(raw);
+    vector<pair<int, int>> updates(BATCH);
+    auto t2 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < rounds; i += BATCH)
+    {
+        for (int j = 0; j < BATCH; ++j) updates[j] = {ls[i + j], (i + j) % MAX_VALUE};
+        batched.update_batch(updates);
+    }
+    auto t3 = chrono::high_resolution_clock::now();
+
+    cout << "  batch of " << BATCH << ": update " << ms(t0, t1) * 1e6 / rounds << "ns"
+         << " -> update_batch " << ms(t2, t3) * 1e6 / rounds << "ns" << endl;
+}
+
+// the whole SegmentTree behind a mutex, the way it is shared without ConcurrentSegmentTree
+struct LockedSegmentTree
+{
+    SegmentTree<int> st;
+    mutable mutex lock;
+    LockedSegmentTree(const vector<int> &raw) : st(raw) {}
+    int query(int l, int r) const
+    {
+        lock_guard<mutex> guard(lock);
+        return st.query(l, r);
+    }
+    void update(int i, int v)
+    {
+        lock_guard<mutex> guard(lock);
+        st.update(i, v);
+    }
+};
+
+// one writer updates nonstop while the readers query for a fixed time, reports the total reader throughput
+template <typename Tree>
+void run_concurrent(const string &name, const vector<int> &raw, int readers)
+{
+    constexpr auto DURATION = chrono::milliseconds(300);
+    int n = raw.size();
+    Tree st(raw);
+    atomic<bool> stop(false);
+    vector<long long> counts(readers), sums(readers);
+    long long updates = 0;
+
+    vector<thread> threads;
+    for (int t = 0; t < readers; ++t)
+    {
+        threads.emplace_back([&, t] {
+            mt19937 rng(t);
+            long long count = 0, sum = 0;
+            while (!stop.load(memory_order_relaxed))
+            {
+                int l = rng() % n;
+                int r = l + rng() % (n - l);
+                sum += st.query(l, r);
+                ++count;
+            }
+            counts[t] = count;
+            sums[t] = sum;
+        });
+    }
+    thread writer([&] {
+        mt19937 rng(-1);
+        while (!stop.load(memory_order_relaxed))
+        {
+            st.update(rng() % n, rng() % MAX_VALUE);
+            ++updates;
+        }
+    });
+    this_thread::sleep_for(DURATION);
+    stop = true;
+    for (auto &t : threads) t.join();
+    writer.join();
+
+    long long total = 0, sum = 0;
+    for (int t = 0; t < readers; ++t) total += counts[t], sum += sums[t];
+    double seconds = chrono::duration<double>(DURATION).count();
+    cout << "  " << name << ", " << readers << " readers: " << total / seconds / 1e6 << "M queries/s"
+         << ", " << updates / seconds / 1e6 << "M updates/s (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && string(argv[1]) == "concurrent")
+    {
+        int n = argc > 2 ? stoi(argv[2]) : 1 << 20;
+        int max_readers = argc > 3 ? stoi(argv[3]) : 64;
+        mt19937 rng(n);
+        vector<int> raw(n);
+        for (int &x : raw) x = rng() % MAX_VALUE;
+        cout << "n = " << n << endl;
+        for (int readers = 1; readers <= max_readers; readers *= 2)
+        {
+            run_concurrent<LockedSegmentTree>("mutex", raw, readers);
+            run_concurrent<ConcurrentSegmentTree<int>>("seqlock", raw, readers);
+        }
+        return 0;
+    }
+
+    vector<int> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(stoi(argv[i]));
+    if (sizes.empty()) sizes = {1 << 20, 1 << 24, 1 << 28};
+    constexpr int ROUNDS = 1000000;
+    for (int n : sizes)
+    {
+        mt19937 rng(n);
+        vector<int> raw(n);
+        for (int &x : raw) x = rng() % MAX_VALUE;
+        vector<int> ls(ROUNDS), rs(ROUNDS);
+        for (int i = 0; i < ROUNDS; ++i)
+        {
+            ls[i] = rng() % n;
+            rs[i] = ls[i] + rng() % (n - ls[i]);
+        }
+        cout << "n = " << n << endl;
+        run<SegmentTree<int>>("binary zkw", raw, ls, rs);
+        run<WideSegmentTree<int>>("16-ary wide", raw, ls, rs);
+        run_batch(raw, ls);
+    }
+    return 0;
+}
+
 #endif
\ No newline at end of file
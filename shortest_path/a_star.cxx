@@ -2,6 +2,10 @@
 #include <vector>
 #include <functional>
 #include <tuple>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <array>
 
 using namespace std;
 
@@ -20,13 +24,13 @@ struct NodeWithDist {
 
 // . for no-block, # for block, t for target
 vector<vector<Node>> a_star(
-    vector<vector<char>> g, 
+    const vector<vector<char>>& g,
     size_t target_x,
     size_t target_y,
     size_t start_x,
     size_t start_y,
     function<int(int, int, int, int)> heuristic,
-    vector<Node> directions
+    const vector<Node>& directions
 ) {
     size_t n = g.size();
     size_t m = g[0].size();
@@ -69,7 +73,7 @@ vector<vector<Node>> a_star(
 }
 
 vector<Node> get_path(
-    vector<vector<Node>> prev,
+    const vector<vector<Node>>& prev,
     size_t target_x,
     size_t target_y,
     size_t start_x,
@@ -89,6 +93,360 @@ vector<Node> get_path(
     return path;
 }
 
+// heuristics for GridAStar, passed as a type so the call is inlined into the search
+// manhattan is admissible for 4-connected grids, chebyshev for 8-connected ones with unit cost
+struct ManhattanHeuristic {
+    int operator()(int x, int y, int tx, int ty) const {
+        return abs(x - tx) + abs(y - ty);
+    }
+};
+
+struct ChebyshevHeuristic {
+    int operator()(int x, int y, int tx, int ty) const {
+        return max(abs(x - tx), abs(y - ty));
+    }
+};
+
+// octile is exact on an empty 8-connected grid where a straight move costs 10 and a diagonal one 14, as in JumpPointExpansion
+struct OctileHeuristic {
+    int operator()(int x, int y, int tx, int ty) const {
+        int dx = abs(x - tx), dy = abs(y - ty);
+        return 10 * max(dx, dy) + 4 * min(dx, dy);
+    }
+};
+
+// the expansion of GridAStar, which cells a search goes to from cur, and at what cost
+// an expansion has
+//     border(), how wide the blocked border around the grid has to be
+//     build(cell, width), called once with the padded grid, '#' for a blocked cell
+//     expand(cell, cur, parent, target, visit), calls visit(next, cost) for every successor of cur
+//     FILL_IN, whether consecutive cells of a path may be further apart than one step along a straight or diagonal line
+
+// every move is one of the given directions and costs 1, like in a_star, a blocked cell can't be entered
+struct StepExpansion {
+    static constexpr bool FILL_IN = false;
+    vector<Node> directions;
+    // the flat offsets of the directions
+    vector<int> step;
+
+    StepExpansion(const vector<Node>& directions) : directions(directions) {}
+
+    // as wide as the longest step, so any directions work, though long ones like knight moves make the padded grid larger
+    int border() const {
+        int ret = 1;
+        for(const Node& d : directions) ret = max({ret, abs(d.x), abs(d.y)});
+        return ret;
+    }
+
+    void build(const vector<char>&, int width) {
+        step.clear();
+        for(const Node& d : directions) {
+            if(d.x != 0 || d.y != 0) step.push_back(d.x * width + d.y);
+        }
+    }
+
+    template <typename Visit>
+    void expand(const vector<char>& cell, int cur, int, int, Visit visit) const {
+        for(int s : step) {
+            if(cell[cur + s] != '#') visit(cur + s, 1);
+        }
+    }
+};
+
+// the 8 neighbours of a cell, with an optional jump point search, for grids where every cell costs the same
+// this is a different cost model from StepExpansion: a straight move costs 10 and a diagonal one 14, about 10 * sqrt(2),
+// and a diagonal move needs both cells beside it free, so corners can't be cut
+// so switching a search to it changes the lengths it returns, not only its speed, use it with OctileHeuristic
+// on such a grid most shortest paths have many symmetric copies, and plain A* expands all of them
+// jump point search only stops at cells where the path may have to turn, the jump points,
+// and skips over the cells in between, so the open set only ever sees a few cells
+// the rows are also kept as bitsets of free cells, so that a horizontal jump checks 64 cells at once
+// with use_jumps set to false, it is plain A* over the 8 neighbours, which gives the same lengths
+struct JumpPointExpansion {
+    static constexpr int STRAIGHT = 10;
+    static constexpr int DIAGONAL = 14;
+    static constexpr bool FILL_IN = true;
+
+    bool use_jumps;
+    bool use_bitset;
+    int width;
+    // bit c % 64 of bits[r * words + c / 64] is set when the padded cell (r, c) is free
+    // every row has one more word than it needs, so that the word after the last one can be read
+    int words;
+    vector<uint64_t> bits;
+
+    JumpPointExpansion(bool use_jumps = true, bool use_bitset = true) : use_jumps(use_jumps), use_bitset(use_bitset), width(0), words(0) {}
+
+    int border() const {
+        return 1;
+    }
+
+    void build(const vector<char>& cell, int width) {
+        this->width = width;
+        words = width / 64 + 2;
+        bits.assign(cell.size() / width * words, 0);
+        for(size_t i = 0; i < cell.size(); ++i) {
+            if(cell[i] != '#') bits[i / width * words + i % width / 64] |= uint64_t(1) << (i % width % 64);
+        }
+    }
+
+    template <typename Visit>
+    void expand(const vector<char>&, int cur, int parent, int target, Visit visit) const {
+        array<pair<int, int>, 8> around;
+        int r = cur / width, c = cur % width;
+        int count = directions(cur, parent, around);
+        for(int k = 0; k < count; ++k) {
+            auto [dr, dc] = around[k];
+            int next = use_jumps ? jump(r, c, dr, dc, target) : (free(r + dr, c + dc) ? cur + dr * width + dc : -1);
+            if(next != -1) visit(next, octile(cur, next));
+        }
+    }
+
+private:
+    bool free(int r, int c) const {
+        return bits[(size_t)r * words + c / 64] >> (c % 64) & 1;
+    }
+
+    int octile(int a, int b) const {
+        int dr = abs(a / width - b / width), dc = abs(a % width - b % width);
+        return STRAIGHT * max(dr, dc) + (DIAGONAL - STRAIGHT) * min(dr, dc);
+    }
+
+    // the directions to look in from cur
+    // without a parent, or without jumping, all moves that are allowed
+    // with a parent, only those that a shortest path through the parent might take, the rest has a path of the same length that avoids cur
+    // they are written to ret, and their count is returned, so that an expansion allocates nothing
+    int directions(int cur, int parent, array<pair<int, int>, 8>& ret) const {
+        int r = cur / width, c = cur % width;
+        int count = 0;
+        if(!use_jumps || parent == -1) {
+            for(int dr = -1; dr <= 1; ++dr) {
+                for(int dc = -1; dc <= 1; ++dc) {
+                    if(dr == 0 && dc == 0) continue;
+                    if(dr != 0 && dc != 0 && !(free(r + dr, c) && free(r, c + dc))) continue;
+                    ret[count++] = {dr, dc};
+                }
+            }
+            return count;
+        }
+        int pr = parent / width, pc = parent % width;
+        int dr = (r > pr) - (r < pr), dc = (c > pc) - (c < pc);
+        if(dr != 0 && dc != 0) {
+            bool vertical = free(r + dr, c), horizontal = free(r, c + dc);
+            if(vertical) ret[count++] = {dr, 0};
+            if(horizontal) ret[count++] = {0, dc};
+            if(vertical && horizontal) ret[count++] = {dr, dc};
+        } else if(dc != 0) {
+            bool ahead = free(r, c + dc), up = free(r - 1, c), down = free(r + 1, c);
+            if(ahead) {
+                ret[count++] = {0, dc};
+                if(up) ret[count++] = {-1, dc};
+                if(down) ret[count++] = {1, dc};
+            }
+            if(up) ret[count++] = {-1, 0};
+            if(down) ret[count++] = {1, 0};
+        } else {
+            bool ahead = free(r + dr, c), right = free(r, c + 1), left = free(r, c - 1);
+            if(ahead) {
+                ret[count++] = {dr, 0};
+                if(right) ret[count++] = {dr, 1};
+                if(left) ret[count++] = {dr, -1};
+            }
+            if(right) ret[count++] = {0, 1};
+            if(left) ret[count++] = {0, -1};
+        }
+        return count;
+    }
+
+    // walk from (r, c) in direction (dr, dc), and return the first jump point, -1 if a block comes first
+    // a jump point is the target, or a cell beside which a block just ended, so that a path may turn there
+    // moving diagonally, a cell from which a straight jump finds a jump point is one too
+    int jump(int r, int c, int dr, int dc, int target) const {
+        if(dr == 0 || dc == 0) return jump_straight(r, c, dr, dc, target);
+        while(true) {
+            r += dr;
+            c += dc;
+            if(!free(r, c)) return -1;
+            int i = r * width + c;
+            if(i == target) return i;
+            if(jump_straight(r, c, 0, dc, target) != -1 || jump_straight(r, c, dr, 0, target) != -1) return i;
+            if(!(free(r + dr, c) && free(r, c + dc))) return -1;
+        }
+    }
+
+    int jump_straight(int r, int c, int dr, int dc, int target) const {
+        if(dr == 0 && use_bitset) return jump_row(r, c, dc, target);
+        while(true) {
+            r += dr;
+            c += dc;
+            if(!free(r, c)) return -1;
+            int i = r * width + c;
+            if(i == target) return i;
+            if(dc != 0 && ((free(r - 1, c) && !free(r - 1, c - dc)) || (free(r + 1, c) && !free(r + 1, c - dc)))) return i;
+            if(dr != 0 && ((free(r, c - 1) && !free(r - dr, c - 1)) || (free(r, c + 1) && !free(r - dr, c + 1)))) return i;
+        }
+    }
+
+    // the same as jump_straight along a row, 64 cells per step
+    // in a word, a cell stops the jump if it is blocked, the target, or free above or below while the cell behind that isn't
+    // "behind" is the neighbouring bit, so it is the word shifted by one, with the bit carried over from the next word
+    int jump_row(int r, int c, int dc, int target) const {
+        const uint64_t* row = bits.data() + (size_t)r * words;
+        const uint64_t* up = row - words;
+        const uint64_t* down = row + words;
+        int target_word = target / width == r ? target % width / 64 : -1;
+        uint64_t target_bit = uint64_t(1) << (target % width % 64);
+        int s = c + dc;
+        for(int w = s / 64; ; w += dc) {
+            uint64_t up_behind, down_behind, mask;
+            if(dc == 1) {
+                up_behind = (up[w] << 1) | (w > 0 ? up[w - 1] >> 63 : 0);
+                down_behind = (down[w] << 1) | (w > 0 ? down[w - 1] >> 63 : 0);
+                // only the cells from s on
+                mask = w == s / 64 ? ~uint64_t(0) << (s % 64) : ~uint64_t(0);
+            } else {
+                up_behind = (up[w] >> 1) | (up[w + 1] << 63);
+                down_behind = (down[w] >> 1) | (down[w + 1] << 63);
+                // only the cells up to s
+                mask = w == s / 64 ? ~uint64_t(0) >> (63 - s % 64) : ~uint64_t(0);
+            }
+            uint64_t stop = ~row[w] | (up[w] & ~up_behind) | (down[w] & ~down_behind);
+            if(w == target_word) stop |= target_bit;
+            stop &= mask;
+            if(stop == 0) continue;
+            // the nearest stop in the direction of the jump, the lowest bit going right and the highest going left
+            int p = w * 64 + (dc == 1 ? __builtin_ctzll(stop) : 63 - __builtin_clzll(stop));
+            return free(r, p) ? r * width + p : -1;
+        }
+    }
+};
+
+// a_star for many queries on the same grid
+// the grid is one flat array with a border of '#' around it, so a neighbour is
+// just cell + offset, and the border stops the search without any bounds check
+// which cells a search goes to and at what cost is up to Expansion, StepExpansion by default,
+// that is, the given directions at cost 1 like in a_star, JumpPointExpansion has a different cost model, see there
+// g, prev and the open and closed sets live in the engine and are reused by every query
+// instead of clearing them, a query bumps generation, and an entry only counts if its stamp matches
+template <typename Heuristic = ManhattanHeuristic, typename Expansion = StepExpansion>
+struct GridAStar {
+    int n;
+    int m;
+    Expansion expansion;
+    // the width of the border, and of a row of the padded grid, the cell (x, y) is at (x + pad) * width + y + pad
+    int pad;
+    int width;
+    vector<char> cell;
+
+    vector<int> dist;
+    vector<int> prev;
+    // seen[i] == generation when dist[i] and prev[i] belong to this query, closed[i] when i is expanded
+    // the stamps start at 0 and generation at 1, so before the first search no cell counts as seen
+    vector<unsigned> seen;
+    vector<unsigned> closed;
+    unsigned generation;
+
+    // an entry of the open set, ties on f go to the smaller h, that is, the one closer to the target
+    struct Open {
+        int f;
+        int h;
+        int i;
+        bool operator<(const Open& other) const {
+            return f != other.f ? f > other.f : h > other.h;
+        }
+    };
+    vector<Open> open;
+
+    Heuristic heuristic;
+
+    // . for no-block, # for block, like a_star
+    GridAStar(const vector<vector<char>>& g, Expansion expansion = Expansion()) :
+        n(g.size()), m(g.empty() ? 0 : g[0].size()), expansion(move(expansion)), pad(this->expansion.border()), width(m + 2 * pad),
+        cell((size_t)(n + 2 * pad) * width, '#'),
+        dist(cell.size()), prev(cell.size()), seen(cell.size(), 0), closed(cell.size(), 0), generation(1) {
+        for(int x = 0; x < n; ++x) {
+            for(int y = 0; y < m; ++y) cell[index(x, y)] = g[x][y];
+        }
+        this->expansion.build(cell, width);
+    }
+
+    // the given directions, for StepExpansion
+    GridAStar(const vector<vector<char>>& g, const vector<Node>& directions) : GridAStar(g, Expansion(directions)) {}
+
+    int index(int x, int y) const {
+        return (x + pad) * width + y + pad;
+    }
+
+    Node coordinate(int i) const {
+        return Node(i / width - pad, i % width - pad);
+    }
+
+    // the length of the shortest path, -1 if the target can't be reached
+    int search(int start_x, int start_y, int target_x, int target_y) {
+        if(++generation == 0) {
+            fill(seen.begin(), seen.end(), 0);
+            fill(closed.begin(), closed.end(), 0);
+            generation = 1;
+        }
+        int start = index(start_x, start_y);
+        int target = index(target_x, target_y);
+        open.clear();
+        seen[start] = generation;
+        dist[start] = 0;
+        prev[start] = -1;
+        int h = heuristic(start_x, start_y, target_x, target_y);
+        open.push_back(Open{h, h, start});
+        while(!open.empty()) {
+            pop_heap(open.begin(), open.end());
+            int cur = open.back().i;
+            open.pop_back();
+            // a cell can be pushed again with a better g, only its first pop counts
+            if(closed[cur] == generation) continue;
+            closed[cur] = generation;
+            if(cur == target) return dist[cur];
+            expansion.expand(cell, cur, prev[cur], target, [&](int next, int cost) {
+                if(closed[next] == generation) return;
+                int d = dist[cur] + cost;
+                if(seen[next] != generation || dist[next] > d) {
+                    seen[next] = generation;
+                    dist[next] = d;
+                    prev[next] = cur;
+                    Node c = coordinate(next);
+                    int nh = heuristic(c.x, c.y, target_x, target_y);
+                    open.push_back(Open{d + nh, nh, next});
+                    push_heap(open.begin(), open.end());
+                }
+            });
+        }
+        return -1;
+    }
+
+    // the path of the last search from its start to target, the same as get_path, empty if it wasn't reached
+    // with FILL_IN, consecutive cells of prev are on one straight or diagonal line, and the cells between them are filled in
+    vector<Node> get_path(int target_x, int target_y) const {
+        vector<Node> path;
+        int i = index(target_x, target_y);
+        if(seen[i] != generation) return path;
+        for(; prev[i] != -1; i = prev[i]) {
+            if(!Expansion::FILL_IN) {
+                path.push_back(coordinate(i));
+                continue;
+            }
+            int r = i / width, c = i % width;
+            int pr = prev[i] / width, pc = prev[i] % width;
+            int dr = (pr > r) - (pr < r), dc = (pc > c) - (pc < c);
+            for(; r != pr || c != pc; r += dr, c += dc) path.push_back(coordinate(r * width + c));
+        }
+        path.push_back(coordinate(i));
+        reverse(path.begin(), path.end());
+        return path;
+    }
+};
+
+// A* for 8-connected grids where every cell costs the same, with jump point search
+// lengths are in units of JumpPointExpansion::STRAIGHT
+using JumpPointSearch = GridAStar<OctileHeuristic, JumpPointExpansion>;
+
 #ifdef DEBUG
 
 #include <iostream>
@@ -154,6 +512,93 @@ int main() {
 
     auto path = get_path(prev, target_x, target_y, start_x, start_y);
     print_graph_and_path(g, path);
+
+    GridAStar<ManhattanHeuristic> engine(g, {Node(0, 1), Node(0, -1), Node(1, 0), Node(-1, 0)});
+    JumpPointSearch jps(g);
+    cout << "before any search: " << engine.get_path(target_x, target_y).size() << " " << jps.get_path(target_x, target_y).size() << endl;
+    int length = engine.search(start_x, start_y, target_x, target_y);
+    cout << "GridAStar: " << length << ", a_star: " << path.size() - 1 << endl;
+
+    JumpPointSearch plain_8(g, JumpPointExpansion(false));
+    int plain = plain_8.search(start_x, start_y, target_x, target_y);
+    int jumped = jps.search(start_x, start_y, target_x, target_y);
+    cout << "8-connected, plain: " << plain << ", jump point search: " << jumped << endl;
+    print_graph_and_path(g, jps.get_path(target_x, target_y));
+    return 0;
+}
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./a_star [side] [queries] [jps]
+// the random-obstacle map of the DEBUG main, 5% blocks, scaled to side x side, 4096 by default
+// with jps, an open 8-connected map with a few long walls instead, and plain A* against jump point search with and without the bitsets
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? stoi(argv[1]) : 4096;
+    int queries = argc > 2 ? stoi(argv[2]) : 20;
+    mt19937 rng(0);
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    if(argc > 3 && string(argv[3]) == "jps") {
+        vector<vector<char>> g(side, vector<char>(side, '.'));
+        // walls of a random length, every one with its ends somewhere on the map
+        for(int i = 0; i < side / 16; ++i) {
+            int x = rng() % side, y = rng() % side, length = rng() % (side / 4);
+            bool vertical = rng() % 2;
+            for(int k = 0; k < length && (vertical ? x + k : y + k) < side; ++k) g[vertical ? x + k : x][vertical ? y : y + k] = '#';
+        }
+        vector<array<int, 4>> qs(queries);
+        for(auto& [sx, sy, tx, ty] : qs) {
+            do {
+                sx = rng() % side, sy = rng() % side, tx = rng() % side, ty = rng() % side;
+            } while(g[sx][sy] == '#' || g[tx][ty] == '#');
+        }
+        JumpPointSearch plain(g, JumpPointExpansion(false)), without_bitset(g, JumpPointExpansion(true, false)), with_bitset(g);
+        long long sums[3] = {0, 0, 0};
+        auto t0 = chrono::high_resolution_clock::now();
+        for(auto [sx, sy, tx, ty] : qs) sums[0] += plain.search(sx, sy, tx, ty);
+        auto t1 = chrono::high_resolution_clock::now();
+        for(auto [sx, sy, tx, ty] : qs) sums[1] += without_bitset.search(sx, sy, tx, ty);
+        auto t2 = chrono::high_resolution_clock::now();
+        for(auto [sx, sy, tx, ty] : qs) sums[2] += with_bitset.search(sx, sy, tx, ty);
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << side << " x " << side << ", per query: plain A* " << ms(t0, t1) / queries << "ms"
+             << ", jump point search " << ms(t1, t2) / queries << "ms"
+             << ", with bitsets " << ms(t2, t3) / queries << "ms"
+             << (sums[0] == sums[1] && sums[0] == sums[2] ? "" : ", WRONG") << endl;
+        return 0;
+    }
+    vector<vector<char>> g(side, vector<char>(side, '.'));
+    for(long long i = 0; i < (long long)side * side / 20; ++i) g[rng() % side][rng() % side] = '#';
+    vector<array<int, 4>> qs(queries);
+    for(auto& [sx, sy, tx, ty] : qs) {
+        do {
+            sx = rng() % side, sy = rng() % side, tx = rng() % side, ty = rng() % side;
+        } while(g[sx][sy] == '#' || g[tx][ty] == '#');
+    }
+    vector<Node> directions = {Node(0, 1), Node(0, -1), Node(1, 0), Node(-1, 0)};
+
+    auto t0 = chrono::high_resolution_clock::now();
+    GridAStar<ManhattanHeuristic> engine(g, directions);
+    auto t1 = chrono::high_resolution_clock::now();
+    long long engine_sum = 0, old_sum = 0;
+    for(auto [sx, sy, tx, ty] : qs) engine_sum += engine.search(sx, sy, tx, ty);
+    auto t2 = chrono::high_resolution_clock::now();
+    for(auto [sx, sy, tx, ty] : qs) {
+        auto prev = a_star(g, tx, ty, sx, sy, [](int x, int y, int tx, int ty) { return abs(x - tx) + abs(y - ty); }, directions);
+        old_sum += prev[tx][ty].x == -1 && (sx != tx || sy != ty) ? -1 : (long long)get_path(prev, tx, ty, sx, sy).size() - 1;
+    }
+    auto t3 = chrono::high_resolution_clock::now();
+    cout << side << " x " << side << ": engine build " << ms(t0, t1) << "ms"
+         << ", per query: GridAStar " << ms(t1, t2) / queries << "ms"
+         << ", a_star " << ms(t2, t3) / queries << "ms"
+         << " (checksums " << engine_sum << " " << old_sum << ")" << endl;
     return 0;
 }
-#endif
\ No newline at end of file
+
+#endif
@@ -1,33 +1,241 @@
 #include <vector>
+#include <queue>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include "../graph/csr_graph.hxx"
+#include "../misc/barrier.hxx"
 
 using namespace std;
 
-struct Edge {
-    int from;
-    int to;
-    int weight;
-    Edge(int from, int to, int weight) : from(from), to(to), weight(weight) {}
+// dist[v] is the distance from the source, INF if v can't be reached
+// if a negative cycle can be reached from the source, the distances are meaningless,
+// and cycle holds its vertices in order, every one having an edge to the next and the last to the first
+struct ShortestPaths {
+    static constexpr int INF = 0x3f3f3f3f;
+    vector<int> dist;
+    vector<int> cycle;
 };
 
-// bellman_ford applies to the graph that has no negative weight cycles
-vector<int> bellman_ford(vector<Edge> es) {
-    int n = es.size();
-    constexpr int INF = 0x3f3f3f3f;
-    vector<int> dist(n, INF);
-    dist[0] = 0;
+// v was still relaxed after n - 1 passes, so its chain of prev leads into a negative cycle
+// after n steps back along prev, it is certainly on the cycle
+vector<int> trace_cycle(int n, const vector<int>& prev, int v) {
+    for(int i = 0; i < n; ++i) v = prev[v];
+    vector<int> cycle;
+    int u = v;
+    do {
+        cycle.push_back(u);
+        u = prev[u];
+    } while(u != v);
+    reverse(cycle.begin(), cycle.end());
+    return cycle;
+}
+
+// bellman_ford applies to the graph that has no negative weight cycles, n is the count of vertices
+// it relaxes all edges at most n - 1 times, and stops as soon as a pass changes nothing
+// a pass that still changes something after n - 1 of them means a negative cycle
+ShortestPaths bellman_ford(int n, const vector<Edge>& es, int source = 0) {
+    constexpr int INF = ShortestPaths::INF;
+    ShortestPaths ret;
+    ret.dist.assign(n, INF);
+    vector<int> prev(n, -1);
+    ret.dist[source] = 0;
 
     // relax n - 1 times, if there were restrictions on the maximum length of the path, we could relax fewer times.
-    for(int i = 0; i < n - 1; ++i) {
+    // the n-th pass only checks for a negative cycle
+    for(int i = 0; i < n; ++i) {
+        int changed = -1;
         // for each edge, relax
-        for(Edge& e : es) {
+        for(const Edge& e : es) {
             int u = e.from;
             int v = e.to;
             int w = e.weight;
-            if(dist[v] > dist[u] + w) {
-                dist[v] = dist[u] + w;
+            // an unreachable u has no distance to pass on
+            if(ret.dist[u] == INF) continue;
+            if(ret.dist[v] > ret.dist[u] + w) {
+                ret.dist[v] = ret.dist[u] + w;
+                prev[v] = u;
+                changed = v;
+            }
+        }
+        // every shortest path is found, no more pass can change anything
+        if(changed == -1) return ret;
+        if(i == n - 1) ret.cycle = trace_cycle(n, prev, changed);
+    }
+
+    return ret;
+}
+
+// the queue based bellman ford, also known as SPFA
+// only the vertices whose distance just dropped have their edges relaxed again
+// a vertex whose shortest path has n edges or more is on or behind a negative cycle
+ShortestPaths spfa(int n, const vector<Edge>& es, int source = 0) {
+    constexpr int INF = ShortestPaths::INF;
+
+    // the edges going out of u are g.to[g.offset[u]..g.offset[u + 1])
+    CsrGraph g(n, es);
+
+    ShortestPaths ret;
+    ret.dist.assign(n, INF);
+    vector<int> prev(n, -1);
+    // edges[v] is the count of edges on the current path to v
+    vector<int> edges(n, 0);
+    vector<char> in_queue(n, false);
+    queue<int> q;
+    ret.dist[source] = 0;
+    q.push(source);
+    in_queue[source] = true;
+    while(!q.empty()) {
+        int u = q.front();
+        q.pop();
+        in_queue[u] = false;
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+            int v = g.to[e];
+            if(ret.dist[v] > ret.dist[u] + g.weight[e]) {
+                ret.dist[v] = ret.dist[u] + g.weight[e];
+                prev[v] = u;
+                edges[v] = edges[u] + 1;
+                if(edges[v] >= n) {
+                    ret.cycle = trace_cycle(n, prev, v);
+                    return ret;
+                }
+                if(!in_queue[v]) {
+                    q.push(v);
+                    in_queue[v] = true;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+// bellman_ford with every pass over the edge array split across threads
+// the distances are atomics lowered with compare and swap, so a thread may already use
+// what another one found in the same pass, which never needs more passes than the serial one
+// the predecessors can't be kept consistent that way, so a negative cycle is traced by the serial version
+// the threads are started once and meet at a barrier after every pass, a thread count below 1 is taken as 1
+ShortestPaths parallel_bellman_ford(int n, const vector<Edge>& es, int source, int threads) {
+    constexpr int INF = ShortestPaths::INF;
+    threads = max(1, threads);
+    vector<atomic<int>> dist(n);
+    for(auto& d : dist) d.store(INF, memory_order_relaxed);
+    dist[source].store(0, memory_order_relaxed);
+
+    // the last pass that lowered some distance, -1 if none did
+    // it only grows, a thread may store i + 1 before a slower one reads it for pass i,
+    // but only after seeing pass i change something, so pass i converged exactly when it is below i
+    atomic<int> changed_pass(-1);
+    Barrier barrier(threads);
+    auto worker = [&](int t) {
+        size_t begin = es.size() * t / threads;
+        size_t end = es.size() * (t + 1) / threads;
+        for(int i = 0; i < n; ++i) {
+            bool local = false;
+            for(size_t k = begin; k < end; ++k) {
+                const Edge& e = es[k];
+                int du = dist[e.from].load(memory_order_relaxed);
+                if(du == INF) continue;
+                int d = du + e.weight;
+                int cur = dist[e.to].load(memory_order_relaxed);
+                while(d < cur) {
+                    if(dist[e.to].compare_exchange_weak(cur, d, memory_order_relaxed)) {
+                        local = true;
+                        break;
+                    }
+                }
             }
+            if(local) changed_pass.store(i, memory_order_relaxed);
+            barrier.wait();
+            if(changed_pass.load(memory_order_relaxed) < i) return;
         }
+    };
+    vector<thread> pool;
+    for(int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for(auto& th : pool) th.join();
+    // the n-th pass still lowered something, there is a negative cycle
+    if(changed_pass.load() == n - 1) return bellman_ford(n, es, source);
+
+    ShortestPaths ret;
+    ret.dist.resize(n);
+    for(int v = 0; v < n; ++v) ret.dist[v] = dist[v].load(memory_order_relaxed);
+    return ret;
+}
+
+#ifdef DEBUG
+
+#include <cstdio>
+
+int main() {
+    vector<Edge> es = {
+        Edge(0, 1, 4), Edge(0, 2, 5), Edge(1, 2, -3),
+        Edge(2, 3, 4), Edge(3, 1, 2), Edge(3, 4, 1)
+    };
+    int n = 5;
+    for(auto ret : {bellman_ford(n, es), spfa(n, es), parallel_bellman_ford(n, es, 0, 2)}) {
+        for(int d : ret.dist) printf("%d ", d);
+        printf("\n");
+    }
+
+    // 1 -> 2 -> 3 -> 1 now weighs -1
+    es[4].weight = -2;
+    for(auto ret : {bellman_ford(n, es), spfa(n, es), parallel_bellman_ford(n, es, 0, 2)}) {
+        printf("negative cycle:");
+        for(int v : ret.cycle) printf(" %d", v);
+        printf("\n");
+    }
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./bellman_ford [n] [m] [max threads], build with -pthread
+// a sparse random graph with n vertices and m edges, 100k and 1M by default
+// the old version relaxed all edges n - 1 times, its time is estimated from a few passes
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? stoi(argv[1]) : 100000;
+    int m = argc > 2 ? stoi(argv[2]) : 1000000;
+    int max_threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    mt19937 rng(0);
+    vector<Edge> es;
+    es.reserve(m);
+    for(int i = 0; i < m; ++i) es.push_back(Edge(rng() % n, rng() % n, 1 + rng() % 100));
+
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    constexpr int FULL_PASSES = 10;
+    vector<int> dist(n, ShortestPaths::INF);
+    dist[0] = 0;
+    auto t0 = chrono::high_resolution_clock::now();
+    for(int i = 0; i < FULL_PASSES; ++i) {
+        for(const Edge& e : es) {
+            if(dist[e.from] != ShortestPaths::INF && dist[e.to] > dist[e.from] + e.weight) dist[e.to] = dist[e.from] + e.weight;
+        }
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+    ShortestPaths early = bellman_ford(n, es);
+    auto t2 = chrono::high_resolution_clock::now();
+    ShortestPaths queued = spfa(n, es);
+    auto t3 = chrono::high_resolution_clock::now();
+    cout << "n - 1 full passes (estimated) " << ms(t0, t1) / FULL_PASSES * (n - 1) << "ms"
+         << ", early exit " << ms(t1, t2) << "ms"
+         << ", spfa " << ms(t2, t3) << "ms" << (queued.dist == early.dist ? "" : ", WRONG") << endl;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        auto t4 = chrono::high_resolution_clock::now();
+        ShortestPaths parallel = parallel_bellman_ford(n, es, 0, threads);
+        auto t5 = chrono::high_resolution_clock::now();
+        cout << "parallel, " << threads << " threads: " << ms(t4, t5) << "ms"
+             << (parallel.dist == early.dist ? "" : ", WRONG") << endl;
     }
+    return 0;
+}
 
-    return dist;
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,367 @@
+#include <vector>
+#include <queue>
+#include <string>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+
+#include "../graph/csr_graph.hxx"
+#include "dijkstra_workspace.hxx"
+#include "node.hxx"
+
+using namespace std;
+
+/*
+Contraction hierarchy:
+
+The vertices are contracted one by one, from the least important to the most important.
+Contracting v removes it from the graph, and for every pair u -> v -> x of its remaining neighbours
+a shortcut u -> x is added, unless a witness search finds a path from u to x that avoids v
+and is not longer. So the distances between the remaining vertices never change.
+
+The order of contraction is the rank of a vertex. Every shortest path can then be written as
+a path that only goes up in rank, followed by one that only goes down. So a query is a bidirectional
+dijkstra where the forward search only takes edges up, and the backward search only takes reversed
+edges up, and both meet at the highest vertex of the path. Both searches stay tiny.
+*/
+
+struct ContractionHierarchy {
+    // rank[v] is the position of v in the contraction order
+    vector<int> rank;
+    // up[u] holds the edges u -> x with rank[x] > rank[u], shortcuts included
+    CsrGraph up;
+    // down[x] holds the edges u -> x with rank[u] > rank[x], reversed, that is, stored as x -> u
+    CsrGraph down;
+
+    ContractionHierarchy() {}
+
+    // g is represented as an adjacency list, directed, no negative weights
+    ContractionHierarchy(const vector<vector<Node>>& g) {
+        build(g);
+    }
+
+    void build(const vector<vector<Node>>& g) {
+        int n = g.size();
+        out.assign(n, {});
+        in.assign(n, {});
+        contracted.assign(n, false);
+        deleted_neighbours.assign(n, 0);
+        witness = DijkstraWorkspace(n);
+        for(int u = 0; u < n; ++u) {
+            for(const Node& e : g[u]) {
+                if(e.n != u) add_edge(u, e.n, e.weight);
+            }
+        }
+
+        // the keys go stale as neighbours get contracted, so they are checked again when popped
+        // this is the lazy update, a vertex is contracted only if it is still the least important
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        for(int v = 0; v < n; ++v) pq.push({priority(v), v});
+
+        // the upward edges of v are its edges at the moment it is contracted
+        // all its remaining neighbours are contracted later, so they rank higher
+        vector<vector<Node>> up_adj(n), down_adj(n);
+        rank.assign(n, 0);
+        for(int order = 0; !pq.empty(); ) {
+            int v = pq.top().second;
+            pq.pop();
+            if(contracted[v]) continue;
+            int p = priority(v);
+            if(!pq.empty() && p > pq.top().first) {
+                pq.push({p, v});
+                continue;
+            }
+            rank[v] = order++;
+            up_adj[v] = out[v];
+            down_adj[v] = in[v];
+            contract(v);
+        }
+        up = CsrGraph(up_adj);
+        down = CsrGraph(down_adj);
+
+        // the contraction state is only needed while building
+        out = {};
+        in = {};
+        contracted = {};
+        deleted_neighbours = {};
+        witness = DijkstraWorkspace();
+    }
+
+    // the length of the shortest path from source to target, 0x3f3f3f3f if there is none
+    int query(int source, int target) {
+        constexpr int INF = DijkstraWorkspace::INF;
+        int n = rank.size();
+        if((int)forward.dist.size() != n) {
+            forward = DijkstraWorkspace(n);
+            backward = DijkstraWorkspace(n);
+        }
+        forward.start(source);
+        backward.start(target);
+        int best = INF;
+        // the two searches take turns, a side stops once its nearest vertex is farther than best
+        bool forward_done = false, backward_done = false;
+        for(bool turn = true; !forward_done || !backward_done; turn = !turn) {
+            if(turn ? forward_done : backward_done) continue;
+            DijkstraWorkspace& ws = turn ? forward : backward;
+            const DijkstraWorkspace& other = turn ? backward : forward;
+            const CsrGraph& graph = turn ? up : down;
+            int u = ws.settle();
+            if(u == -1 || ws.get_dist(u) >= best) {
+                (turn ? forward_done : backward_done) = true;
+                continue;
+            }
+            if(other.get_dist(u) < INF) best = min(best, ws.get_dist(u) + other.get_dist(u));
+            ws.relax_edges(graph, u);
+        }
+        return best;
+    }
+
+    // the hierarchy in a binary file, so that the preprocessing runs only once
+    // the file is the three int arrays of rank, up and down, every array led by its length
+    bool save(const string& path) const {
+        ofstream file(path, ios::binary);
+        auto write = [&](const vector<int>& a) {
+            long long size = a.size();
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char*>(a.data()), size * sizeof(int));
+        };
+        for(const vector<int>* a : {&rank, &up.offset, &up.to, &up.weight, &down.offset, &down.to, &down.weight}) write(*a);
+        return bool(file);
+    }
+
+    // a file that is cut short or whose arrays don't fit together is rejected, and the hierarchy is left as it was
+    bool load(const string& path) {
+        ifstream file(path, ios::binary | ios::ate);
+        if(!file) return false;
+        long long left = file.tellg();
+        file.seekg(0);
+        auto read = [&](vector<int>& a) {
+            long long size = 0;
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            left -= sizeof(size);
+            // a corrupt length must not make resize allocate more than the file holds
+            if(!file || size < 0 || size > left / (long long)sizeof(int)) return false;
+            a.resize(size);
+            file.read(reinterpret_cast<char*>(a.data()), size * sizeof(int));
+            left -= size * sizeof(int);
+            return bool(file);
+        };
+        vector<int> new_rank;
+        CsrGraph new_up, new_down;
+        for(vector<int>* a : {&new_rank, &new_up.offset, &new_up.to, &new_up.weight, &new_down.offset, &new_down.to, &new_down.weight}) {
+            if(!read(*a)) return false;
+        }
+        int n = new_rank.size();
+        if(!well_formed(new_up, n) || !well_formed(new_down, n)) return false;
+        // rank is a permutation of 0..n - 1
+        vector<char> used(n, false);
+        for(int r : new_rank) {
+            if(r < 0 || r >= n || used[r]) return false;
+            used[r] = true;
+        }
+        rank.swap(new_rank);
+        up = move(new_up);
+        down = move(new_down);
+        return true;
+    }
+
+private:
+    // used by query, sized on the first query after build or load
+    DijkstraWorkspace forward;
+    DijkstraWorkspace backward;
+
+    // g has n vertices, its offsets start at 0 and never go down, and every edge points to one of them with no negative weight
+    // so query can't index out of range on it
+    static bool well_formed(const CsrGraph& g, int n) {
+        if(g.offset.size() != (size_t)n + 1 || g.offset[0] != 0) return false;
+        for(int u = 0; u < n; ++u) {
+            if(g.offset[u] > g.offset[u + 1]) return false;
+        }
+        if((size_t)g.offset[n] != g.to.size() || g.to.size() != g.weight.size()) return false;
+        for(size_t e = 0; e < g.to.size(); ++e) {
+            if(g.to[e] < 0 || g.to[e] >= n || g.weight[e] < 0) return false;
+        }
+        return true;
+    }
+
+    // the graph during contraction, the edges of contracted vertices are removed from it
+    vector<vector<Node>> out;
+    vector<vector<Node>> in;
+    vector<char> contracted;
+    // how many neighbours of v are already contracted, spreads the contraction evenly over the graph
+    vector<int> deleted_neighbours;
+    DijkstraWorkspace witness;
+
+    // a witness search gives up after settling this many vertices
+    // giving up only adds a shortcut that wasn't needed, it never makes a distance wrong
+    static constexpr int WITNESS_SETTLE_LIMIT = 500;
+
+    // the shortcuts contracting v would add, as (u -> x, via length) where Node(x, w) is the edge
+    vector<pair<Node, int>> shortcuts(int v) {
+        vector<pair<Node, int>> ret;
+        int max_out = 0;
+        for(const Node& e : out[v]) max_out = max(max_out, e.weight);
+        for(const Node& in_edge : in[v]) {
+            int u = in_edge.n;
+            // one witness search from u covers all the out neighbours of v
+            // nothing longer than u -> v -> x for the farthest x is of interest
+            int limit = in_edge.weight + max_out;
+            witness.start(u);
+            for(int settled = 0; settled < WITNESS_SETTLE_LIMIT; ++settled) {
+                int a = witness.settle();
+                if(a == -1 || witness.get_dist(a) > limit) break;
+                for(const Node& e : out[a]) {
+                    if(e.n != v) witness.push(e.n, witness.get_dist(a) + e.weight, a);
+                }
+            }
+            for(const Node& out_edge : out[v]) {
+                int x = out_edge.n;
+                if(x == u) continue;
+                int via = in_edge.weight + out_edge.weight;
+                if(witness.get_dist(x) > via) ret.push_back({Node(x, via), u});
+            }
+        }
+        return ret;
+    }
+
+    // edge difference plus deleted neighbours, the lower the earlier v is contracted
+    int priority(int v) {
+        return (int)shortcuts(v).size() - (int)in[v].size() - (int)out[v].size() + deleted_neighbours[v];
+    }
+
+    // add u -> x with weight w, or lower the existing one
+    void add_edge(int u, int x, int w) {
+        for(Node& e : out[u]) {
+            if(e.n == x) {
+                if(e.weight <= w) return;
+                e.weight = w;
+                for(Node& r : in[x]) {
+                    if(r.n == u) r.weight = w;
+                }
+                return;
+            }
+        }
+        out[u].push_back(Node(x, w));
+        in[x].push_back(Node(u, w));
+    }
+
+    void contract(int v) {
+        for(auto& [edge, u] : shortcuts(v)) add_edge(u, edge.n, edge.weight);
+        // v is out of the graph now, drop the edges that point to it
+        for(const Node& e : in[v]) {
+            auto& edges = out[e.n];
+            edges.erase(remove_if(edges.begin(), edges.end(), [&](const Node& f) { return f.n == v; }), edges.end());
+            ++deleted_neighbours[e.n];
+        }
+        for(const Node& e : out[v]) {
+            auto& edges = in[e.n];
+            edges.erase(remove_if(edges.begin(), edges.end(), [&](const Node& f) { return f.n == v; }), edges.end());
+            ++deleted_neighbours[e.n];
+        }
+        contracted[v] = true;
+    }
+};
+
+#ifdef DEBUG
+
+#include <cstdio>
+
+int main() {
+    vector<vector<Node>> g = {
+        {Node(1, 1), Node(2, 12)},
+        {Node(2, 9), Node(3, 3)},
+        {Node(4, 5)},
+        {Node(2, 4), Node(4, 13), Node(5, 15)},
+        {Node(5, 4)},
+        {Node(6, 13)},
+        {Node(4, 3), Node(5, 5)}
+    };
+    ContractionHierarchy ch(g);
+    for(int i = 0; i < (int)g.size(); i++) {
+        printf("%d: %d\n", i, ch.query(0, i));
+    }
+
+    ch.save("ch.bin");
+    ContractionHierarchy loaded;
+    if(loaded.load("ch.bin")) printf("loaded: %d\n", loaded.query(0, 6));
+    remove("ch.bin");
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./contraction_hierarchy [side]
+// a side x side grid with random weights, a stand-in for a road network
+
+#include <iostream>
+#include <chrono>
+#include <random>
+
+// the plain dijkstra of dijkstra.cxx that stops at target, to compare against
+int dijkstra(const vector<vector<Node>>& g, int source, int target) {
+    constexpr int INF = 0x3f3f3f3f;
+    vector<int> dist(g.size(), INF);
+    vector<char> vis(g.size(), false);
+    priority_queue<Node> pq;
+    pq.push(Node(source, 0));
+    dist[source] = 0;
+    while(!pq.empty()) {
+        int u = pq.top().n;
+        pq.pop();
+        if(vis[u]) continue;
+        if(u == target) break;
+        vis[u] = true;
+        for(const Node& next : g[u]) {
+            if(dist[next.n] > dist[u] + next.weight) {
+                dist[next.n] = dist[u] + next.weight;
+                pq.push(Node(next.n, dist[next.n]));
+            }
+        }
+    }
+    return dist[target];
+}
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? stoi(argv[1]) : 300;
+    constexpr int QUERIES = 1000;
+    int n = side * side;
+    mt19937 rng(0);
+    vector<vector<Node>> g(n);
+    for(int x = 0; x < side; ++x) {
+        for(int y = 0; y < side; ++y) {
+            int u = x * side + y;
+            int w = 1 + rng() % 100;
+            if(x + 1 < side) g[u].push_back(Node(u + side, w)), g[u + side].push_back(Node(u, w));
+            w = 1 + rng() % 100;
+            if(y + 1 < side) g[u].push_back(Node(u + 1, w)), g[u + 1].push_back(Node(u, w));
+        }
+    }
+    vector<pair<int, int>> queries(QUERIES);
+    for(auto& [s, t] : queries) s = rng() % n, t = rng() % n;
+
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    auto t0 = chrono::high_resolution_clock::now();
+    ContractionHierarchy ch(g);
+    auto t1 = chrono::high_resolution_clock::now();
+    ch.save("ch_benchmark.bin");
+    ContractionHierarchy loaded;
+    loaded.load("ch_benchmark.bin");
+    remove("ch_benchmark.bin");
+    auto t2 = chrono::high_resolution_clock::now();
+    long long ch_sum = 0, dijkstra_sum = 0;
+    for(auto [s, t] : queries) ch_sum += loaded.query(s, t);
+    auto t3 = chrono::high_resolution_clock::now();
+    for(auto [s, t] : queries) dijkstra_sum += dijkstra(g, s, t);
+    auto t4 = chrono::high_resolution_clock::now();
+    cout << "grid " << side << " x " << side << ": preprocessing " << ms(t0, t1) << "ms"
+         << ", " << ch.up.to.size() + ch.down.to.size() << " upward edges"
+         << ", save + load " << ms(t1, t2) << "ms" << endl
+         << "per query: hierarchy " << ms(t2, t3) * 1e3 / QUERIES << "us"
+         << ", early-exit dijkstra " << ms(t3, t4) * 1e3 / QUERIES << "us"
+         << " (checksums " << ch_sum << " " << dijkstra_sum << ")" << endl;
+    return 0;
+}
+
+#endif
@@ -1,21 +1,20 @@
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
-using namespace std;
+#include "../graph/csr_graph.hxx"
+#include "../graph/indexed_heap.hxx"
+#include "dijkstra_workspace.hxx"
+#include "node.hxx"
+#include "../misc/barrier.hxx"
 
-// Node is just type with data and weight, doesn't indicate it's an edge nor a node in graph
-struct Node {
-    int n;
-    int weight;
-    Node(int n, int weight) : n(n), weight(weight) {}
-    bool operator<(const Node& other) const {
-        return weight > other.weight;
-    }
-};
+using namespace std;
 
 // dijkstra applies to the graph that has no negative weight edges
 // g is represented as an adjacency list
-vector<int> dijkstra(vector<vector<Node>> g, int source) {
+vector<int> dijkstra(const vector<vector<Node>>& g, int source) {
     int n = g.size();
     priority_queue<Node> pq;
     constexpr int INF = 0x3f3f3f3f;
@@ -37,7 +36,7 @@ vector<int> dijkstra(vector<vector<Node>> g, int source) {
         vis[u] = true;
 
         // update the distance to the last node
-        for(Node& next : g[u]) {
+        for(const Node& next : g[u]) {
             int v = next.n;
             int w = next.weight;
             // relax
@@ -52,8 +51,309 @@ vector<int> dijkstra(vector<vector<Node>> g, int source) {
     return dist;
 }
 
+// the priority queues dijkstra can run on, picked at compile time
+// every queue is built from the graph, and offers
+//   push(v, d), a tentative distance d for v
+//   pop(), the entry with the smallest distance, as a Node(v, d)
+//   empty()
+// a queue may hand out stale entries, whose d is larger than dist[v] by then, dijkstra skips them with vis
+
+// the binary heap of priority_queue, with lazy deletion, it can hold O(E) entries
+struct BinaryHeapQueue {
+    priority_queue<Node> pq;
+    BinaryHeapQueue(const CsrGraph&) {}
+    void push(int v, int d) { pq.push(Node(v, d)); }
+    Node pop() {
+        Node ret = pq.top();
+        pq.pop();
+        return ret;
+    }
+    bool empty() const { return pq.empty(); }
+};
+
+// Dial's bucket queue, for small non-negative integer weights
+// all tentative distances in the queue lie in cur..=cur + C, where C is the largest weight
+// so C + 1 buckets used as a ring are enough, and push and pop are O(1) amortized
+struct DialQueue {
+    vector<vector<Node>> buckets;
+    int cur;
+    int count;
+    DialQueue(const CsrGraph& g) : cur(0), count(0) {
+        int c = 0;
+        for(int w : g.weight) c = max(c, w);
+        buckets.resize(c + 1);
+    }
+    void push(int v, int d) {
+        buckets[d % buckets.size()].push_back(Node(v, d));
+        ++count;
+    }
+    Node pop() {
+        while(buckets[cur % buckets.size()].empty()) ++cur;
+        auto& bucket = buckets[cur % buckets.size()];
+        Node ret = bucket.back();
+        bucket.pop_back();
+        --count;
+        return ret;
+    }
+    bool empty() const { return count == 0; }
+};
+
+// radix heap, works because dijkstra pops distances in non-decreasing order
+// bucket 0 holds the entries equal to last, the last popped distance
+// bucket i holds the entries that first differ from last at bit i - 1
+// an entry only moves to a lower bucket, so it is moved at most 32 times in total
+struct RadixHeapQueue {
+    vector<Node> buckets[33];
+    unsigned last;
+    int count;
+    RadixHeapQueue(const CsrGraph&) : last(0), count(0) {}
+    static int bucket_of(unsigned d, unsigned last) {
+        int ret = 0;
+        for(unsigned x = d ^ last; x > 0; x /= 2) ++ret;
+        return ret;
+    }
+    void push(int v, int d) {
+        buckets[bucket_of(d, last)].push_back(Node(v, d));
+        ++count;
+    }
+    Node pop() {
+        if(buckets[0].empty()) {
+            int i = 1;
+            while(buckets[i].empty()) ++i;
+            // the smallest entry of bucket i becomes last, and the rest of bucket i spreads to lower buckets
+            unsigned smallest = buckets[i][0].weight;
+            for(const Node& e : buckets[i]) smallest = min(smallest, (unsigned)e.weight);
+            last = smallest;
+            for(const Node& e : buckets[i]) buckets[bucket_of(e.weight, last)].push_back(e);
+            buckets[i].clear();
+        }
+        Node ret = buckets[0].back();
+        buckets[0].pop_back();
+        --count;
+        return ret;
+    }
+    bool empty() const { return count == 0; }
+};
+
+// a 4-ary heap indexed by vertex, push on a vertex already in the heap is a decrease-key
+// so it never holds more than n entries, and never hands out a stale one
+struct FourAryHeapQueue {
+    IndexedHeap<4> heap;
+    FourAryHeapQueue(const CsrGraph& g) : heap(g.size()) {}
+    void push(int v, int d) { heap.push(v, d); }
+    Node pop() {
+        int v = heap.pop();
+        return Node(v, heap.key[v]);
+    }
+    bool empty() const { return heap.empty(); }
+};
+
+// the same as above, on a CsrGraph, with the priority queue picked by Queue
+template<typename Queue = BinaryHeapQueue>
+vector<int> dijkstra(const CsrGraph& g, int source) {
+    int n = g.size();
+    Queue pq(g);
+    constexpr int INF = 0x3f3f3f3f;
+    vector<int> dist(n, INF);
+    vector<char> vis(n, false);
+    pq.push(source, 0);
+    dist[source] = 0;
+
+    while(!pq.empty()) {
+        int u = pq.pop().n;
+        if(vis[u]) continue;
+        vis[u] = true;
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+            int v = g.to[e];
+            if(dist[v] > dist[u] + g.weight[e]) {
+                dist[v] = dist[u] + g.weight[e];
+                pq.push(v, dist[v]);
+            }
+        }
+    }
+
+    return dist;
+}
+
+// point-to-point dijkstra, it stops as soon as target is settled
+// returns the distance, and ws.get_path(target) gives the path
+int dijkstra(const CsrGraph& g, int source, int target, DijkstraWorkspace& ws) {
+    ws.start(source);
+    for(int u = ws.settle(); u != -1; u = ws.settle()) {
+        if(u == target) break;
+        ws.relax_edges(g, u);
+    }
+    return ws.get_dist(target);
+}
+
+int dijkstra(const CsrGraph& g, int source, int target) {
+    DijkstraWorkspace ws(g.size());
+    return dijkstra(g, source, target, ws);
+}
+
+// searches from the source on g and from the target on the reversed graph at the same time
+// both balls grow to about half the distance, which settles far fewer vertices than one search
+// keep one object per graph and reuse it for all queries, its workspaces are never cleared
+// only a pointer to g is kept, so g has to outlive the object, and a temporary graph is refused
+struct BidirectionalDijkstra {
+    const CsrGraph* g;
+    CsrGraph reversed;
+    DijkstraWorkspace forward;
+    DijkstraWorkspace backward;
+    // the vertex where the shortest path found by the last query crosses from forward to backward
+    int meet;
+
+    BidirectionalDijkstra(const CsrGraph& g) : g(&g), reversed(g.reversed()), forward(g.size()), backward(g.size()), meet(-1) {}
+    BidirectionalDijkstra(CsrGraph&&) = delete;
+
+    int query(int source, int target) {
+        constexpr int INF = DijkstraWorkspace::INF;
+        forward.start(source);
+        backward.start(target);
+        int best = source == target ? 0 : INF;
+        meet = source == target ? source : -1;
+        while(true) {
+            int top_f = forward.peek();
+            int top_b = backward.peek();
+            // any path not found yet has to go through a vertex unsettled on both sides
+            // so it is at least top_f + top_b long
+            if(top_f == INF || top_b == INF || top_f + top_b >= best) break;
+            // grow the side whose frontier is closer
+            bool go_forward = top_f <= top_b;
+            DijkstraWorkspace& ws = go_forward ? forward : backward;
+            const DijkstraWorkspace& other = go_forward ? backward : forward;
+            const CsrGraph& graph = go_forward ? *g : reversed;
+            int u = ws.settle();
+            ws.relax_edges(graph, u);
+            // a new path either ends at u or uses one of the edges just relaxed
+            if(other.get_dist(u) < INF && ws.get_dist(u) + other.get_dist(u) < best) {
+                best = ws.get_dist(u) + other.get_dist(u);
+                meet = u;
+            }
+            for(int e = graph.offset[u]; e < graph.offset[u + 1]; ++e) {
+                int v = graph.to[e];
+                int d = ws.get_dist(v) + other.get_dist(v);
+                if(other.get_dist(v) < INF && d < best) {
+                    best = d;
+                    meet = v;
+                }
+            }
+        }
+        return best;
+    }
+
+    // the vertices of the path found by the last query, empty if there is none
+    vector<int> get_path() const {
+        if(meet == -1) return {};
+        vector<int> path = forward.get_path(meet);
+        // in the reversed graph, prev leads from meet towards the target
+        for(int v = backward.prev[meet]; v != -1; v = backward.prev[v]) path.push_back(v);
+        return path;
+    }
+};
+
+// delta-stepping, a parallel single source shortest path with the same result as dijkstra
+// vertices are kept in buckets of width delta by their tentative distance, and the lowest bucket
+// is processed as a whole: all its vertices relax their edges at once, split across the threads
+// edges of weight at most delta can put vertices back into the same bucket, so they are relaxed
+// until the bucket stays empty, heavier edges can't, so they are relaxed once when it is done
+// a small delta does less wasted work, a large one gives more parallelism, delta = 1 is dijkstra
+// distances are divided by delta to find their bucket, so a delta below 1 is taken as 1
+// the threads are started once and reused by every phase, a thread count below 1 is taken as 1
+vector<int> delta_stepping(const CsrGraph& g, int source, int delta, int threads) {
+    delta = max(delta, 1);
+    threads = max(threads, 1);
+    int n = g.size();
+    constexpr int INF = 0x3f3f3f3f;
+    vector<atomic<int>> dist(n);
+    for(auto& d : dist) d.store(INF, memory_order_relaxed);
+    dist[source].store(0, memory_order_relaxed);
+
+    // while bucket i is processed, every tentative distance lies in bucket i..=i + ceil(max weight / delta)
+    // so that many buckets are reused cyclically, bucket b lives at buckets[b % buckets.size()]
+    // and the memory depends on the weights over delta, not on the longest distance
+    int max_weight = 0;
+    for(int w : g.weight) max_weight = max(max_weight, w);
+    vector<vector<int>> buckets((max_weight + delta - 1) / delta + 1);
+    buckets[0].push_back(source);
+    // the entries in all buckets, stale ones included, the search ends when there are none
+    size_t pending = 1;
+    // every thread collects the vertices whose distance it lowered, they are bucketed afterwards
+    vector<vector<int>> changed(threads);
+    // stamp[v] == phase when v was already put into a bucket or into done during this phase
+    vector<int> stamp(n, -1);
+    int phase = 0;
+    WorkerPool pool(threads);
+
+    // lower dist[v] to d unless another thread got it lower already
+    auto relax = [&](int v, int d, vector<int>& out) {
+        int cur = dist[v].load(memory_order_relaxed);
+        while(d < cur) {
+            if(dist[v].compare_exchange_weak(cur, d, memory_order_relaxed)) {
+                out.push_back(v);
+                return;
+            }
+        }
+    };
+    // relax the light or heavy edges going out of the given vertices, in parallel
+    // small sets aren't worth waking the workers for, they run on the calling thread
+    auto relax_all = [&](const vector<int>& vertices, bool light) {
+        constexpr int MIN_PER_THREAD = 4096;
+        int count = vertices.size();
+        auto work = [&](int t, int begin, int end) {
+            for(int i = begin; i < end; ++i) {
+                int u = vertices[i];
+                int du = dist[u].load(memory_order_relaxed);
+                for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) {
+                    if((g.weight[e] <= delta) == light) relax(g.to[e], du + g.weight[e], changed[t]);
+                }
+            }
+        };
+        if(count < 2 * MIN_PER_THREAD) work(0, 0, count);
+        else pool.run([&](int t) { work(t, (long long)count * t / threads, (long long)count * (t + 1) / threads); });
+        ++phase;
+        for(auto& out : changed) {
+            for(int v : out) {
+                if(stamp[v] == phase) continue;
+                stamp[v] = phase;
+                buckets[dist[v].load(memory_order_relaxed) / delta % buckets.size()].push_back(v);
+                ++pending;
+            }
+            out.clear();
+        }
+    };
+
+    for(int i = 0; pending > 0; ++i) {
+        vector<int>& bucket = buckets[i % buckets.size()];
+        vector<int> done;
+        while(!bucket.empty()) {
+            vector<int> frontier;
+            ++phase;
+            for(int v : bucket) {
+                // a vertex whose distance dropped into a lower bucket since it was put here is stale
+                if(dist[v].load(memory_order_relaxed) / delta != i || stamp[v] == phase) continue;
+                stamp[v] = phase;
+                frontier.push_back(v);
+                done.push_back(v);
+            }
+            pending -= bucket.size();
+            bucket.clear();
+            relax_all(frontier, true);
+        }
+        sort(done.begin(), done.end());
+        done.erase(unique(done.begin(), done.end()), done.end());
+        relax_all(done, false);
+    }
+
+    vector<int> ret(n);
+    for(int v = 0; v < n; ++v) ret[v] = dist[v].load(memory_order_relaxed);
+    return ret;
+}
+
 #ifdef DEBUG
 
+#include <cstdio>
+
 int main() {
     vector<vector<Node>> g = {
         {Node(1, 1), Node(2, 12)},
@@ -68,7 +368,190 @@ int main() {
     for(int i = 0; i < dist.size(); i++) {
         printf("%d: %d\n", i, dist[i]);
     }
+
+    CsrGraph csr(g);
+    printf("%s\n", dijkstra(csr, 0) == dist ? "csr matches" : "csr differs");
+    bool same = dijkstra<DialQueue>(csr, 0) == dist && dijkstra<RadixHeapQueue>(csr, 0) == dist && dijkstra<FourAryHeapQueue>(csr, 0) == dist;
+    printf("%s\n", same ? "queues match" : "queues differ");
+
+    printf("%s\n", delta_stepping(csr, 0, 4, 2) == dist ? "delta-stepping matches" : "delta-stepping differs");
+
+    DijkstraWorkspace ws(csr.size());
+    BidirectionalDijkstra bi(csr);
+    for(int target : {4, 6}) {
+        printf("0 -> %d: %d, bidirectional %d, path", target, dijkstra(csr, 0, target, ws), bi.query(0, target));
+        for(int v : ws.get_path(target)) printf(" %d", v);
+        printf(", bidirectional path");
+        for(int v : bi.get_path()) printf(" %d", v);
+        printf("\n");
+    }
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./dijkstra [n] [m]
+//        ./dijkstra queues [side] [n]
+//        ./dijkstra p2p [side]
+//        ./dijkstra delta [n] [m] [delta] [max threads]
+// the first compares graph representations on a random graph with n vertices and m directed edges, 1M and 10M by default
+// the second compares the queues on a side x side grid and a scale-free graph with n vertices, 1000 and 1M by default
+// the third compares full, early-exit and bidirectional point-to-point queries on a side x side grid
+// the fourth runs delta-stepping with 1, 2, 4 .. threads on a random graph, build with -pthread for it
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+// how dijkstra used to be called, g taken by value, so every call deep-copies it
+vector<int> dijkstra_by_value(vector<vector<Node>> g, int source) {
+    return dijkstra(g, source);
+}
+
+template<typename Queue>
+void run_queue(const string& name, const CsrGraph& g, const vector<int>& expected) {
+    auto t0 = chrono::high_resolution_clock::now();
+    vector<int> dist = dijkstra<Queue>(g, 0);
+    auto t1 = chrono::high_resolution_clock::now();
+    cout << "  " << name << ": " << chrono::duration<double, milli>(t1 - t0).count() << "ms"
+         << (dist == expected ? "" : ", WRONG") << endl;
+}
+
+void run_queues(const string& name, const CsrGraph& g) {
+    cout << name << ", " << g.size() << " vertices, " << g.to.size() << " edges" << endl;
+    vector<int> expected = dijkstra(g, 0);
+    run_queue<BinaryHeapQueue>("binary heap", g, expected);
+    run_queue<DialQueue>("dial buckets", g, expected);
+    run_queue<RadixHeapQueue>("radix heap", g, expected);
+    run_queue<FourAryHeapQueue>("4-ary indexed heap", g, expected);
+}
+
+// 4-connected grid with weights 1..=10
+CsrGraph make_grid(int side, mt19937& rng) {
+    vector<Edge> grid;
+    for(int x = 0; x < side; ++x) {
+        for(int y = 0; y < side; ++y) {
+            int u = x * side + y;
+            if(x + 1 < side) {
+                grid.push_back(Edge(u, u + side, 1 + rng() % 10));
+                grid.push_back(Edge(u + side, u, 1 + rng() % 10));
+            }
+            if(y + 1 < side) {
+                grid.push_back(Edge(u, u + 1, 1 + rng() % 10));
+                grid.push_back(Edge(u + 1, u, 1 + rng() % 10));
+            }
+        }
+    }
+    return CsrGraph(side * side, grid);
+}
+
+int main(int argc, char** argv) {
+    auto ms = [](auto a, auto b) { return chrono::duration<double, milli>(b - a).count(); };
+    if(argc > 1 && string(argv[1]) == "p2p") {
+        int side = argc > 2 ? stoi(argv[2]) : 1000;
+        constexpr int QUERIES = 20;
+        mt19937 rng(0);
+        CsrGraph g = make_grid(side, rng);
+        vector<pair<int, int>> queries(QUERIES);
+        for(auto& [s, t] : queries) {
+            s = rng() % g.size();
+            t = rng() % g.size();
+        }
+        DijkstraWorkspace ws(g.size());
+        BidirectionalDijkstra bi(g);
+        long long full_sum = 0, early_sum = 0, bi_sum = 0;
+        auto t0 = chrono::high_resolution_clock::now();
+        for(auto [s, t] : queries) full_sum += dijkstra(g, s)[t];
+        auto t1 = chrono::high_resolution_clock::now();
+        for(auto [s, t] : queries) early_sum += dijkstra(g, s, t, ws);
+        auto t2 = chrono::high_resolution_clock::now();
+        for(auto [s, t] : queries) bi_sum += bi.query(s, t);
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << "grid " << side << " x " << side << ", per query: full " << ms(t0, t1) / QUERIES << "ms"
+             << ", early exit " << ms(t1, t2) / QUERIES << "ms"
+             << ", bidirectional " << ms(t2, t3) / QUERIES << "ms"
+             << " (checksums " << full_sum << " " << early_sum << " " << bi_sum << ")" << endl;
+        return 0;
+    }
+
+    if(argc > 1 && string(argv[1]) == "delta") {
+        int n = argc > 2 ? stoi(argv[2]) : 1000000;
+        int m = argc > 3 ? stoi(argv[3]) : 10000000;
+        int delta = argc > 4 ? stoi(argv[4]) : 50;
+        int max_threads = argc > 5 ? stoi(argv[5]) : max(1u, thread::hardware_concurrency());
+        mt19937 rng(0);
+        vector<Edge> es;
+        es.reserve(m);
+        for(int i = 0; i < m; ++i) es.push_back(Edge(rng() % n, rng() % n, 1 + rng() % 100));
+        CsrGraph g(n, es);
+        auto t0 = chrono::high_resolution_clock::now();
+        vector<int> expected = dijkstra(g, 0);
+        auto t1 = chrono::high_resolution_clock::now();
+        cout << "dijkstra: " << ms(t0, t1) << "ms" << endl;
+        for(int threads = 1; threads <= max_threads; threads *= 2) {
+            auto t2 = chrono::high_resolution_clock::now();
+            vector<int> dist = delta_stepping(g, 0, delta, threads);
+            auto t3 = chrono::high_resolution_clock::now();
+            cout << "delta-stepping, delta " << delta << ", " << threads << " threads: " << ms(t2, t3) << "ms"
+                 << (dist == expected ? "" : ", WRONG") << endl;
+        }
+        return 0;
+    }
+
+    if(argc > 1 && string(argv[1]) == "queues") {
+        int side = argc > 2 ? stoi(argv[2]) : 1000;
+        int n = argc > 3 ? stoi(argv[3]) : 1000000;
+        mt19937 rng(0);
+        run_queues("grid", make_grid(side, rng));
+
+        // preferential attachment, every new vertex links to 4 ends of random earlier edges
+        // so a vertex is picked in proportion to its degree, which gives a scale-free graph
+        vector<Edge> scale_free = {Edge(0, 1, 1), Edge(1, 0, 1)};
+        for(int u = 2; u < n; ++u) {
+            for(int k = 0; k < 4; ++k) {
+                int v = scale_free[rng() % scale_free.size()].to;
+                int w = 1 + rng() % 100;
+                scale_free.push_back(Edge(u, v, w));
+                scale_free.push_back(Edge(v, u, w));
+            }
+        }
+        run_queues("scale-free", CsrGraph(n, scale_free));
+        return 0;
+    }
+
+    int n = argc > 1 ? stoi(argv[1]) : 1000000;
+    int m = argc > 2 ? stoi(argv[2]) : 10000000;
+    constexpr int QUERIES = 5;
+    mt19937 rng(0);
+    vector<Edge> es;
+    es.reserve(m);
+    for(int i = 0; i < m; ++i) es.push_back(Edge(rng() % n, rng() % n, 1 + rng() % 100));
+    vector<vector<Node>> g(n);
+    for(const Edge& e : es) g[e.from].push_back(Node(e.to, e.weight));
+
+    auto t0 = chrono::high_resolution_clock::now();
+    CsrGraph from_edges(n, es);
+    auto t1 = chrono::high_resolution_clock::now();
+    CsrGraph from_list(g);
+    auto t2 = chrono::high_resolution_clock::now();
+    cout << "build csr: from edges " << ms(t0, t1) << "ms, from adjacency list " << ms(t1, t2) << "ms" << endl;
+
+    long long sum = 0;
+    auto t3 = chrono::high_resolution_clock::now();
+    for(int q = 0; q < QUERIES; ++q) sum += dijkstra_by_value(g, q)[n - 1];
+    auto t4 = chrono::high_resolution_clock::now();
+    for(int q = 0; q < QUERIES; ++q) sum -= dijkstra(g, q)[n - 1];
+    auto t5 = chrono::high_resolution_clock::now();
+    for(int q = 0; q < QUERIES; ++q) sum += dijkstra(from_list, q)[n - 1];
+    auto t6 = chrono::high_resolution_clock::now();
+    cout << "per query: adjacency list by value " << ms(t3, t4) / QUERIES << "ms"
+         << ", by reference " << ms(t4, t5) / QUERIES << "ms"
+         << ", csr " << ms(t5, t6) / QUERIES << "ms"
+         << " (checksum " << sum << ")" << endl;
     return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "../graph/csr_graph.hxx"
+
+using namespace std;
+
+// the state of a point-to-point search, kept between queries so that it is never cleared
+// instead of resetting dist and vis for all n vertices, every query gets a new round number
+// an entry only counts when its stamp equals the current round, so starting a query is O(1)
+// shared by dijkstra.cxx and by the witness and query searches of contraction_hierarchy.cxx
+struct DijkstraWorkspace {
+    static constexpr int INF = 0x3f3f3f3f;
+    vector<int> dist;
+    // prev[v] is the vertex before v on the shortest path, -1 for the source
+    vector<int> prev;
+    // seen[v] == round when dist[v] and prev[v] belong to this query, settled[v] == round when v is done
+    // the stamps start at 0 and round at 1, so before the first query no vertex counts as seen
+    vector<unsigned> seen;
+    vector<unsigned> settled;
+    unsigned round;
+    // (distance, vertex), the nearest on top
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+
+    DijkstraWorkspace(int n = 0) : dist(n), prev(n), seen(n, 0), settled(n, 0), round(1) {}
+
+    // forget the last query
+    void start(int source) {
+        // only after 2 ** 32 queries the stamps wrap around and really have to be cleared
+        if(++round == 0) {
+            fill(seen.begin(), seen.end(), 0);
+            fill(settled.begin(), settled.end(), 0);
+            round = 1;
+        }
+        pq = {};
+        seen[source] = round;
+        dist[source] = 0;
+        prev[source] = -1;
+        pq.push({0, source});
+    }
+
+    int get_dist(int v) const {
+        return seen[v] == round ? dist[v] : INF;
+    }
+
+    bool is_settled(int v) const {
+        return settled[v] == round;
+    }
+
+    // pop the nearest vertex that isn't settled yet and settle it, -1 when there is none
+    int settle() {
+        while(!pq.empty()) {
+            int u = pq.top().second;
+            pq.pop();
+            if(is_settled(u)) continue;
+            settled[u] = round;
+            return u;
+        }
+        return -1;
+    }
+
+    // the distance of the next vertex settle would return, INF when there is none
+    int peek() {
+        while(!pq.empty() && is_settled(pq.top().second)) pq.pop();
+        return pq.empty() ? INF : pq.top().first;
+    }
+
+    // reach v at distance d coming from u, kept only if it is shorter than what v has
+    void push(int v, int d, int u) {
+        if(d < get_dist(v)) {
+            seen[v] = round;
+            dist[v] = d;
+            prev[v] = u;
+            pq.push({d, v});
+        }
+    }
+
+    void relax_edges(const CsrGraph& g, int u) {
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e) push(g.to[e], dist[u] + g.weight[e], u);
+    }
+
+    // the vertices from the source to target, empty if target wasn't reached
+    vector<int> get_path(int target) const {
+        vector<int> path;
+        if(seen[target] != round) return path;
+        for(int v = target; v != -1; v = prev[v]) path.push_back(v);
+        reverse(path.begin(), path.end());
+        return path;
+    }
+};
@@ -1,4 +1,9 @@
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+#include "../misc/barrier.hxx"
 
 using namespace std;
 
@@ -6,7 +11,7 @@ constexpr int INF = 0x3f3f3f3f;
 
 // floyd applies to the graph that has no negative weight cycles
 // g is represented as an adjacency matrix
-vector<vector<int>> floyd(vector<vector<int>> g) {
+vector<vector<int>> floyd(const vector<vector<int>>& g) {
     int n = g.size();
     vector<vector<int>> dist(n, vector<int>(n, INF));
 
@@ -42,6 +47,190 @@ vector<vector<int>> floyd(vector<vector<int>> g) {
     return dist;
 }
 
+// an n x n matrix in one contiguous row-major array
+struct Matrix {
+    int n;
+    vector<int> val;
+    Matrix(int n, int fill = INF) : n(n), val((size_t)n * n, fill) {}
+    int* operator[](int i) { return val.data() + (size_t)i * n; }
+    const int* operator[](int i) const { return val.data() + (size_t)i * n; }
+};
+
+// the blocked floyd works on BLOCK x BLOCK tiles, 64 x 64 ints is 16KB, so three tiles fit in L1
+constexpr int BLOCK = 64;
+
+// c[i][j] = min(c[i][j], a[i][k] + b[k][j]) for every k of the tile, k outermost
+// so it stays correct when c is the same tile as a or b, which the diagonal, row and column tiles need
+// the inner loop has no branch, the compiler turns it into vector adds and mins
+// INF + INF still fits in an int, so INF needs no special case either
+void min_plus(int* c, const int* a, const int* b, int stride) {
+    for(int k = 0; k < BLOCK; ++k) {
+        const int* bk = b + (size_t)k * stride;
+        for(int i = 0; i < BLOCK; ++i) {
+            int* ci = c + (size_t)i * stride;
+            int aik = a[(size_t)i * stride + k];
+            for(int j = 0; j < BLOCK; ++j) ci[j] = min(ci[j], aik + bk[j]);
+        }
+    }
+}
+
+// run f(x) for every x in 0..count, split across the workers of pool
+template<typename F>
+void parallel_for(WorkerPool& pool, int count, F f) {
+    int threads = pool.size();
+    pool.run([&](int t) {
+        for(int x = t; x < count; x += threads) f(x);
+    });
+}
+
+// the same as floyd, on tiles of the matrix, split across threads
+// for every diagonal tile kk, the k of the original loop runs over the BLOCK values of kk in three phases
+//   the diagonal tile (kk, kk) only depends on itself
+//   the tiles of row kk and of column kk then only depend on themselves and the diagonal tile
+//   every other tile (i, j) then only depends on (i, kk) and (kk, j)
+// the tiles within a phase are independent, so each phase is spread over the threads
+// the threads are started once and reused by every phase, there are never more than the 2 * tiles of the row and column phase
+Matrix blocked_floyd(const Matrix& g, int threads = 1) {
+    int n = g.n;
+    int tiles = (n + BLOCK - 1) / BLOCK;
+    // pad to whole tiles, the padding vertices have no edges so they change nothing
+    // the initialization is the same as floyd
+    Matrix dist(tiles * BLOCK);
+    int stride = dist.n;
+    for(int i = 0; i < stride; ++i) dist[i][i] = 0;
+    for(int i = 0; i < n; ++i) {
+        for(int j = 0; j < n; ++j) {
+            if(g[i][j] != INF) dist[i][j] = g[i][j];
+        }
+    }
+    auto tile = [&](int ti, int tj) { return dist[ti * BLOCK] + tj * BLOCK; };
+    WorkerPool pool(max(1, min(threads, 2 * tiles)));
+
+    for(int kk = 0; kk < tiles; ++kk) {
+        min_plus(tile(kk, kk), tile(kk, kk), tile(kk, kk), stride);
+        parallel_for(pool, 2 * tiles, [&](int x) {
+            int t = x / 2;
+            if(t == kk) return;
+            if(x % 2 == 0) min_plus(tile(kk, t), tile(kk, kk), tile(kk, t), stride);
+            else min_plus(tile(t, kk), tile(t, kk), tile(kk, kk), stride);
+        });
+        parallel_for(pool, tiles, [&](int ti) {
+            if(ti == kk) return;
+            for(int tj = 0; tj < tiles; ++tj) {
+                if(tj != kk) min_plus(tile(ti, tj), tile(ti, kk), tile(kk, tj), stride);
+            }
+        });
+    }
+
+    Matrix ret(n);
+    for(int i = 0; i < n; ++i) {
+        for(int j = 0; j < n; ++j) {
+            // with negative weights, INF plus a negative weight can drift below INF, it is still unreachable
+            ret[i][j] = dist[i][j] > INF / 2 ? INF : dist[i][j];
+        }
+    }
+    return ret;
+}
+
+// all-pairs distances that can also give the paths, and take lowered edges without starting over
+// next[i][j] is the vertex after i on the shortest path from i to j, -1 if there is none
+// it is stored in 16 bits when the vertex indices fit, which halves the matrix, and in 32 bits otherwise
+struct AllPairs {
+    Matrix dist;
+    bool keep_paths;
+    vector<int16_t> next16;
+    vector<int32_t> next32;
+
+    // g is an adjacency matrix, INF for no edge, the graph must have no negative weight cycles
+    AllPairs(const Matrix& g, bool keep_paths = true, int threads = 1) : dist(0), keep_paths(keep_paths) {
+        int n = g.n;
+        // without the next hops there is nothing to track, the blocked version is much faster
+        if(!keep_paths) {
+            dist = blocked_floyd(g, threads);
+            return;
+        }
+        if(n <= INT16_MAX) next16.assign((size_t)n * n, -1);
+        else next32.assign((size_t)n * n, -1);
+
+        dist = Matrix(n);
+        for(int i = 0; i < n; ++i) {
+            dist[i][i] = 0;
+            set_next(i, i, i);
+            for(int j = 0; j < n; ++j) {
+                if(g[i][j] != INF) {
+                    dist[i][j] = g[i][j];
+                    set_next(i, j, j);
+                }
+            }
+        }
+        for(int k = 0; k < n; ++k) {
+            for(int i = 0; i < n; ++i) {
+                if(dist[i][k] == INF) continue;
+                int* di = dist[i];
+                const int* dk = dist[k];
+                for(int j = 0; j < n; ++j) {
+                    if(dk[j] == INF) continue;
+                    // the path to j now goes through k, so it starts the same way as the path to k
+                    if(di[j] > di[k] + dk[j]) {
+                        di[j] = di[k] + dk[j];
+                        set_next(i, j, get_next(i, k));
+                    }
+                }
+            }
+        }
+    }
+
+    int get_next(int i, int j) const {
+        size_t at = (size_t)i * dist.n + j;
+        return next16.empty() ? next32[at] : next16[at];
+    }
+
+    // the vertices of the shortest path from i to j, empty if j can't be reached
+    vector<int> path(int i, int j) const {
+        vector<int> ret;
+        if(!keep_paths || dist[i][j] == INF) return ret;
+        ret.push_back(i);
+        while(i != j) {
+            i = get_next(i, j);
+            ret.push_back(i);
+        }
+        return ret;
+    }
+
+    // the edge u -> v now weighs w, which must not be more than before, O(n ** 2)
+    // a path that gets shorter has to use the new edge, so it is i ~> u -> v ~> j,
+    // and the two ends don't change, since using u -> v in them would make a negative cycle
+    // a self loop never shortens a path, so u == v changes nothing
+    void decrease_edge(int u, int v, int w) {
+        if(u == v) return;
+        int n = dist.n;
+        for(int i = 0; i < n; ++i) {
+            // like in floyd, dist[i][i] may hold a self loop instead of 0, so the ends that stay put are 0 explicitly
+            int to_u = i == u ? 0 : dist[i][u];
+            if(to_u == INF) continue;
+            int* di = dist[i];
+            const int* dv = dist[v];
+            int through = to_u + w;
+            int first = i == u ? v : (keep_paths ? get_next(i, u) : -1);
+            for(int j = 0; j < n; ++j) {
+                int from_v = j == v ? 0 : dv[j];
+                if(from_v == INF) continue;
+                if(di[j] > through + from_v) {
+                    di[j] = through + from_v;
+                    if(keep_paths) set_next(i, j, first);
+                }
+            }
+        }
+    }
+
+private:
+    void set_next(int i, int j, int k) {
+        size_t at = (size_t)i * dist.n + j;
+        if(next16.empty()) next32[at] = k;
+        else next16[at] = k;
+    }
+};
+
 #ifdef DEBUG
 
 #include <iostream>
@@ -63,7 +252,104 @@ int main() {
         cout << endl;
     }
 
+    Matrix m(g.size());
+    for(int i = 0; i < (int)g.size(); ++i) {
+        for(int j = 0; j < (int)g.size(); ++j) m[i][j] = g[i][j];
+    }
+    Matrix blocked = blocked_floyd(m, 2);
+    for(int i = 0; i < blocked.n; ++i) {
+        for(int j = 0; j < blocked.n; ++j) {
+            cout << blocked[i][j] << ' ';
+        }
+        cout << endl;
+    }
+
+    AllPairs all(m);
+    for(int v : all.path(0, 2)) cout << v << ' ';
+    cout << endl;
+    // 0 -> 3 used to take 1 + 3
+    all.decrease_edge(0, 3, 1);
+    cout << all.dist[0][2] << ": ";
+    for(int v : all.path(0, 2)) cout << v << ' ';
+    cout << endl;
+
+    return 0;
+}
+
+#endif
+
+#ifdef BENCHMARK
+
+// usage: ./floyd [n] [max threads]
+//        ./floyd decrease [n] [updates]
+// build with -O3 -march=native -pthread, gcc only vectorizes the kernel from -O3, and -march=native lets it use AVX2
+// a dense random graph, the original floyd is timed too, so keep n moderate
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+
+int main(int argc, char** argv) {
+    auto seconds = [](auto a, auto b) { return chrono::duration<double>(b - a).count(); };
+    if(argc > 1 && string(argv[1]) == "decrease") {
+        int n = argc > 2 ? stoi(argv[2]) : 1000;
+        int updates = argc > 3 ? stoi(argv[3]) : 100;
+        mt19937 rng(0);
+        Matrix g(n);
+        for(int i = 0; i < n; ++i) {
+            for(int j = 0; j < n; ++j) {
+                if(rng() % 10 == 0) g[i][j] = 1 + rng() % 1000;
+            }
+        }
+        auto t0 = chrono::high_resolution_clock::now();
+        AllPairs all(g);
+        auto t1 = chrono::high_resolution_clock::now();
+        for(int k = 0; k < updates; ++k) {
+            int u = rng() % n, v = rng() % n;
+            if(u == v) continue;
+            g[u][v] = min(g[u][v], (int)(1 + rng() % 10));
+            all.decrease_edge(u, v, g[u][v]);
+        }
+        auto t2 = chrono::high_resolution_clock::now();
+        Matrix expected = blocked_floyd(g);
+        auto t3 = chrono::high_resolution_clock::now();
+        cout << "n = " << n << ", next hops in " << (all.next16.empty() ? 32 : 16) << " bits"
+             << ": full floyd with paths " << seconds(t0, t1) << "s"
+             << ", blocked floyd " << seconds(t2, t3) << "s"
+             << ", decrease_edge " << seconds(t1, t2) / updates * 1e3 << "ms"
+             << (expected.val == all.dist.val ? "" : ", WRONG") << endl;
+        return 0;
+    }
+
+    int n = argc > 1 ? stoi(argv[1]) : 1500;
+    int max_threads = argc > 2 ? stoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    mt19937 rng(0);
+    vector<vector<int>> g(n, vector<int>(n, INF));
+    Matrix m(n);
+    for(int i = 0; i < n; ++i) {
+        for(int j = 0; j < n; ++j) {
+            if(rng() % 10 == 0) g[i][j] = 1 + rng() % 1000;
+            m[i][j] = g[i][j];
+        }
+    }
+    // every relaxation is an add and a min, which is counted as 2 operations
+    double ops = 2.0 * n * n * n;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    vector<vector<int>> expected = floyd(g);
+    auto t1 = chrono::high_resolution_clock::now();
+    cout << "original: " << seconds(t0, t1) << "s, " << ops / seconds(t0, t1) / 1e9 << " GFLOP/s" << endl;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        auto t2 = chrono::high_resolution_clock::now();
+        Matrix dist = blocked_floyd(m, threads);
+        auto t3 = chrono::high_resolution_clock::now();
+        bool same = true;
+        for(int i = 0; i < n; ++i) same = same && equal(expected[i].begin(), expected[i].end(), dist[i]);
+        cout << "blocked, " << threads << " threads: " << seconds(t2, t3) << "s, "
+             << ops / seconds(t2, t3) / 1e9 << " GFLOP/s" << (same ? "" : ", WRONG") << endl;
+    }
     return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+using namespace std;
+
+// Node is just type with data and weight, doesn't indicate it's an edge nor a node in graph
+// shared by dijkstra.cxx and contraction_hierarchy.cxx, the adjacency lists of both are vector<vector<Node>>
+// operator< is reversed, so a priority_queue<Node> pops the smallest weight first
+struct Node {
+    int n;
+    int weight;
+    Node(int n, int weight) : n(n), weight(weight) {}
+    bool operator<(const Node& other) const {
+        return weight > other.weight;
+    }
+};